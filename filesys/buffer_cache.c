@@ -0,0 +1,272 @@
+/* buffer_cache.c: Write-behind cache of file system disk sectors. */
+
+#include "filesys/buffer_cache.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Ticks between two runs of the write-behind worker. */
+#define WRITE_BEHIND_INTERVAL (5 * TIMER_FREQ)
+
+/* A cached copy of one sector.
+ * SECTOR, VALID and DIRTY change only while LOCK is held, and
+ * an entry is re-targeted to another sector only while
+ * CACHE_LOCK is held as well.  While an entry is being handed
+ * from SECTOR to NEXT_SECTOR it is IN_TRANSIT, and lookups of
+ * either sector wait for it, so no sector is ever cached twice
+ * or read from disk before its old copy is written out. */
+struct cache_entry {
+	disk_sector_t sector;           /* Cached sector. */
+	bool valid;                     /* DATA holds SECTOR's contents. */
+	bool dirty;                     /* DATA differs from the disk. */
+	bool accessed;                  /* Used since the clock last passed. */
+	bool in_transit;                /* Being evicted for NEXT_SECTOR. */
+	disk_sector_t next_sector;      /* Sector it is being evicted for. */
+	struct lock lock;               /* Guards DATA and the fields above. */
+	uint8_t *data;                  /* DISK_SECTOR_SIZE bytes. */
+};
+
+static struct cache_entry cache[BUFFER_CACHE_SIZE];
+static struct lock cache_lock;      /* Guards sector -> entry mapping. */
+static struct condition transit_done; /* An eviction finished. */
+static size_t clock_hand;
+static bool cache_ready;
+
+static long long hit_cnt, miss_cnt, writeback_cnt;
+
+static void buffer_cache_workerd (void *aux UNUSED);
+
+/* Initializes the buffer cache and starts the write-behind
+ * worker. */
+void
+buffer_cache_init (void) {
+	size_t per_page = PGSIZE / DISK_SECTOR_SIZE;
+	uint8_t *pages = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP (BUFFER_CACHE_SIZE, per_page));
+
+	lock_init (&cache_lock);
+	cond_init (&transit_done);
+	for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		e->valid = e->dirty = e->accessed = e->in_transit = false;
+		lock_init (&e->lock);
+		e->data = pages + i * DISK_SECTOR_SIZE;
+	}
+	clock_hand = 0;
+	cache_ready = true;
+
+	thread_create ("bc_workerd", PRI_DEFAULT, buffer_cache_workerd, NULL);
+}
+
+/* Writes every dirty sector back.  Called on shutdown. */
+void
+buffer_cache_done (void) {
+	if (cache_ready)
+		buffer_cache_flush ();
+}
+
+/* Writes E back if it is dirty.  E->lock must be held. */
+static void
+entry_writeback (struct cache_entry *e) {
+	ASSERT (lock_held_by_current_thread (&e->lock));
+
+	if (e->valid && e->dirty) {
+		disk_write (filesys_disk, e->sector, e->data);
+		e->dirty = false;
+		writeback_cnt++;
+	}
+}
+
+/* Returns the entry caching SECTOR, or being evicted from or for
+ * it, or NULL.  CACHE_LOCK must be held. */
+static struct cache_entry *
+entry_lookup (disk_sector_t sector) {
+	for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->valid && e->sector == sector)
+			return e;
+		if (e->in_transit && e->next_sector == sector)
+			return e;
+	}
+	return NULL;
+}
+
+/* Picks an entry to hold a new sector with the clock algorithm.
+ * Entries that someone is using are passed over while an idle
+ * one can be found, and entries already being evicted always are.
+ * Returns NULL if every entry is being evicted.  CACHE_LOCK must
+ * be held. */
+static struct cache_entry *
+entry_select_victim (void) {
+	for (size_t scanned = 0; scanned < 3 * BUFFER_CACHE_SIZE; scanned++) {
+		struct cache_entry *e = &cache[clock_hand];
+		clock_hand = (clock_hand + 1) % BUFFER_CACHE_SIZE;
+
+		if (e->in_transit)
+			continue;
+		if (!e->valid)
+			return e;
+		if (e->lock.holder != NULL)
+			continue;
+		if (e->accessed)
+			e->accessed = false;
+		else
+			return e;
+	}
+	/* Every entry is busy: take the first one the hand reaches that
+	 * is not being evicted and wait for its user. */
+	for (size_t scanned = 0; scanned < BUFFER_CACHE_SIZE; scanned++) {
+		struct cache_entry *e = &cache[clock_hand];
+		clock_hand = (clock_hand + 1) % BUFFER_CACHE_SIZE;
+		if (!e->in_transit)
+			return e;
+	}
+	return NULL;
+}
+
+/* Returns the entry for SECTOR with its lock held, loading the
+ * sector if needed.  If FILL is false the caller overwrites the
+ * whole sector, so a miss does not read the disk. */
+static struct cache_entry *
+entry_get (disk_sector_t sector, bool fill) {
+	struct cache_entry *e;
+
+	ASSERT (cache_ready);
+
+	lock_acquire (&cache_lock);
+	for (;;) {
+		e = entry_lookup (sector);
+		if (e != NULL && !e->in_transit)
+			break;
+		if (e == NULL) {
+			e = entry_select_victim ();
+			if (e != NULL)
+				break;
+		}
+		/* SECTOR or every entry is on its way in or out. */
+		cond_wait (&transit_done, &cache_lock);
+	}
+	if (e->valid && e->sector == sector) {
+		hit_cnt++;
+		lock_release (&cache_lock);
+		lock_acquire (&e->lock);
+		/* E may have been handed to another sector between
+		 * dropping CACHE_LOCK and getting E->lock; retry then. */
+		if (e->valid && e->sector == sector) {
+			e->accessed = true;
+			return e;
+		}
+		lock_release (&e->lock);
+		return entry_get (sector, fill);
+	}
+
+	miss_cnt++;
+	e->in_transit = true;
+	e->next_sector = sector;
+	lock_release (&cache_lock);
+
+	/* The old contents go out before the mapping changes, so no
+	 * one can read a stale copy of the old sector from disk.
+	 * Lookups of either sector wait meanwhile. */
+	lock_acquire (&e->lock);
+	entry_writeback (e);
+
+	lock_acquire (&cache_lock);
+	e->sector = sector;
+	e->valid = true;
+	e->accessed = true;
+	e->in_transit = false;
+	cond_broadcast (&transit_done, &cache_lock);
+	lock_release (&cache_lock);
+
+	if (fill) {
+#ifdef EFILESYS
+		/* The newest copy of a metadata sector may still be waiting
+		 * in the journal. */
+		if (journal_read (sector, e->data))
+			return e;
+#endif
+		disk_read (filesys_disk, sector, e->data);
+	}
+	return e;
+}
+
+/* Reads SIZE bytes at offset OFS within SECTOR into BUFFER. */
+void
+buffer_cache_read (disk_sector_t sector, void *buffer, off_t ofs,
+		off_t size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	struct cache_entry *e = entry_get (sector, true);
+	memcpy (buffer, e->data + ofs, size);
+	lock_release (&e->lock);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS within SECTOR.
+ * The data reaches the disk on eviction, on the next run of the
+ * write-behind worker or on buffer_cache_done(). */
+void
+buffer_cache_write (disk_sector_t sector, const void *buffer, off_t ofs,
+		off_t size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	struct cache_entry *e = entry_get (sector, size < DISK_SECTOR_SIZE);
+	memcpy (e->data + ofs, buffer, size);
+	e->dirty = true;
+	lock_release (&e->lock);
+}
+
+/* Like buffer_cache_write(), for a sector of file system metadata.
+ * While the journal is in use the new sector goes to the disk through
+ * it, and the cached copy stays clean. */
+void
+buffer_cache_write_meta (disk_sector_t sector, const void *buffer, off_t ofs,
+		off_t size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	struct cache_entry *e = entry_get (sector, size < DISK_SECTOR_SIZE);
+	memcpy (e->data + ofs, buffer, size);
+	e->dirty = true;
+#ifdef EFILESYS
+	if (journal_log (sector, e->data))
+		e->dirty = false;
+#endif
+	lock_release (&e->lock);
+}
+
+/* Writes all dirty entries back to disk. */
+void
+buffer_cache_flush (void) {
+	for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		lock_acquire (&e->lock);
+		entry_writeback (e);
+		lock_release (&e->lock);
+	}
+}
+
+/* Prints buffer cache statistics. */
+void
+buffer_cache_print_stats (void) {
+	printf ("Buffer cache: %lld hits, %lld misses, %lld writebacks\n",
+			hit_cnt, miss_cnt, writeback_cnt);
+}
+
+/* Write-behind worker: periodically flushes dirty entries so a
+ * crash loses at most one interval of writes and eviction rarely
+ * has to wait for a write. */
+static void
+buffer_cache_workerd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (WRITE_BEHIND_INTERVAL);
+		buffer_cache_flush ();
+	}
+}
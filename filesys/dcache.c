@@ -0,0 +1,169 @@
+/* dcache.c: Cache of directory entries for path resolution. */
+
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+#ifdef EFILESYS
+/* The result of looking up NAME in directory DIR. A negative entry
+ * (FOUND false) records that there is no such name.
+ * A directory's entries only change under its dir_index lock, and
+ * directory.c adds and invalidates entries only while holding it, so
+ * a lookup can never cache a result that a concurrent change has
+ * already made stale. */
+struct dcache_entry {
+	disk_sector_t dir;              /* Inode sector of the directory. */
+	char name[NAME_MAX + 1];        /* Name looked up. */
+	bool found;                     /* False for a negative entry. */
+	disk_sector_t sector;           /* Inode sector of NAME, if FOUND. */
+	struct hash_elem hash_elem;     /* Element in names. */
+	struct list_elem lru_elem;      /* Element in lru. */
+};
+
+static struct hash names;           /* dcache_entry by (DIR, NAME). */
+static struct list lru;             /* Most recently used first. */
+static size_t entry_cnt;
+static struct lock dcache_lock;     /* Guards everything above. */
+
+static uint64_t
+dcache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dcache_entry *de = hash_entry (e, struct dcache_entry,
+			hash_elem);
+	return hash_string (de->name) ^ hash_int (de->dir);
+}
+
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dcache_entry *a = hash_entry (a_, struct dcache_entry,
+			hash_elem);
+	const struct dcache_entry *b = hash_entry (b_, struct dcache_entry,
+			hash_elem);
+	if (a->dir != b->dir)
+		return a->dir < b->dir;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void) {
+	if (!hash_init (&names, dcache_hash, dcache_less, NULL))
+		PANIC ("dcache creation failed");
+	list_init (&lru);
+	entry_cnt = 0;
+	lock_init (&dcache_lock);
+}
+
+/* Returns the entry for NAME in DIR, or NULL.
+ * DCACHE_LOCK must be held. */
+static struct dcache_entry *
+dcache_find (disk_sector_t dir, const char *name) {
+	struct dcache_entry key;
+	struct hash_elem *e;
+
+	if (strlen (name) > NAME_MAX)
+		return NULL;
+	key.dir = dir;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&names, &key.hash_elem);
+	return e != NULL? hash_entry (e, struct dcache_entry, hash_elem): NULL;
+}
+
+/* Drops DE from the cache.  DCACHE_LOCK must be held. */
+static void
+dcache_drop (struct dcache_entry *de) {
+	hash_delete (&names, &de->hash_elem);
+	list_remove (&de->lru_elem);
+	entry_cnt--;
+	free (de);
+}
+
+/* Looks NAME in directory DIR up in the cache. On a hit returns true
+ * and sets *FOUND to whether DIR has such a name and, if so, *SECTORP
+ * to its inode sector. Returns false on a miss. */
+bool
+dcache_lookup (disk_sector_t dir, const char *name, bool *found,
+		disk_sector_t *sectorp) {
+	struct dcache_entry *de;
+
+	lock_acquire (&dcache_lock);
+	de = dcache_find (dir, name);
+	if (de != NULL) {
+		list_remove (&de->lru_elem);
+		list_push_front (&lru, &de->lru_elem);
+		*found = de->found;
+		if (de->found)
+			*sectorp = de->sector;
+	}
+	lock_release (&dcache_lock);
+	return de != NULL;
+}
+
+/* Records the result of looking up NAME in directory DIR: whether it
+ * was FOUND and at which inode SECTOR. The least recently used entry
+ * makes room once the cache is full. */
+void
+dcache_insert (disk_sector_t dir, const char *name, bool found,
+		disk_sector_t sector) {
+	struct dcache_entry *de;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	de = dcache_find (dir, name);
+	if (de == NULL) {
+		if (entry_cnt >= DCACHE_SIZE)
+			dcache_drop (list_entry (list_back (&lru), struct dcache_entry,
+					lru_elem));
+		de = malloc (sizeof *de);
+		if (de == NULL)
+			goto done;
+		de->dir = dir;
+		strlcpy (de->name, name, sizeof de->name);
+		hash_insert (&names, &de->hash_elem);
+		entry_cnt++;
+	} else
+		list_remove (&de->lru_elem);
+	list_push_front (&lru, &de->lru_elem);
+	de->found = found;
+	de->sector = sector;
+done:
+	lock_release (&dcache_lock);
+}
+
+/* Forgets what is known about NAME in directory DIR. Called when NAME
+ * is added to or removed from DIR. */
+void
+dcache_invalidate (disk_sector_t dir, const char *name) {
+	struct dcache_entry *de;
+
+	lock_acquire (&dcache_lock);
+	de = dcache_find (dir, name);
+	if (de != NULL)
+		dcache_drop (de);
+	lock_release (&dcache_lock);
+}
+
+/* Forgets every entry looked up in directory DIR. Called when DIR is
+ * removed, since its sector may come back as another directory. */
+void
+dcache_purge_dir (disk_sector_t dir) {
+	struct list_elem *e;
+
+	lock_acquire (&dcache_lock);
+	for (e = list_begin (&lru); e != list_end (&lru);) {
+		struct dcache_entry *de = list_entry (e, struct dcache_entry,
+				lru_elem);
+		e = list_next (e);
+		if (de->dir == dir)
+			dcache_drop (de);
+	}
+	lock_release (&dcache_lock);
+}
+#endif /* EFILESYS */
@@ -6,6 +6,7 @@
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 #include "filesys/fat.h"
+#include "filesys/dcache.h"
 
 /* eleshock */
 #include "threads/vaddr.h"
@@ -34,6 +35,109 @@ struct dir_entry
 					   // #endif
 };
 
+#ifdef EFILESYS
+/* Jack */
+/* Directories with at least this many slots are looked up through a
+ * dir_index; smaller ones are cheaper to scan. */
+#define DIR_INDEX_MIN_ENTRIES 64
+
+/* An entry in use, in a dir_index. */
+struct dir_index_entry
+{
+	struct hash_elem elem;		/* Element in dir_index.names. */
+	struct dir_entry e;			/* Copy of the entry. */
+	off_t ofs;					/* Offset of the entry in the directory. */
+};
+
+static uint64_t
+dir_index_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_string (hash_entry (e, struct dir_index_entry, elem)->e.name);
+}
+
+static bool
+dir_index_less (const struct hash_elem *a, const struct hash_elem *b,
+				void *aux UNUSED)
+{
+	return strcmp (hash_entry (a, struct dir_index_entry, elem)->e.name,
+				   hash_entry (b, struct dir_index_entry, elem)->e.name) < 0;
+}
+
+static void
+dir_index_free (struct hash_elem *e, void *aux UNUSED)
+{
+	free (hash_entry (e, struct dir_index_entry, elem));
+}
+
+/* Initializes INDEX, which is built on first use. */
+void
+dir_index_init (struct dir_index *index)
+{
+	index->built = false;
+	index->free_hint = 0;
+	lock_init (&index->lock);
+}
+
+/* Frees INDEX. */
+void
+dir_index_destroy (struct dir_index *index)
+{
+	if (index->built)
+		hash_destroy (&index->names, dir_index_free);
+	index->built = false;
+}
+
+/* Adds E, at offset OFS, to INDEX if it is built. If memory runs out
+ * the index is dropped, to be rebuilt on the next lookup. */
+static void
+dir_index_insert (struct dir_index *index, const struct dir_entry *e,
+				  off_t ofs)
+{
+	struct dir_index_entry *ie;
+
+	if (!index->built)
+		return;
+	ie = malloc (sizeof *ie);
+	if (ie == NULL) {
+		dir_index_destroy (index);
+		return;
+	}
+	ie->e = *e;
+	ie->ofs = ofs;
+	hash_insert (&index->names, &ie->elem);
+}
+
+/* Removes NAME from INDEX if it is built. */
+static void
+dir_index_delete (struct dir_index *index, const char *name)
+{
+	struct dir_index_entry key;
+	struct hash_elem *e;
+
+	if (!index->built)
+		return;
+	strlcpy (key.e.name, name, sizeof key.e.name);
+	e = hash_delete (&index->names, &key.elem);
+	if (e != NULL)
+		dir_index_free (e, NULL);
+}
+
+/* Builds INDEX from the COUNT entries in ENTRIES. Returns false if
+ * memory runs out. */
+static bool
+dir_index_build (struct dir_index *index, const struct dir_entry *entries,
+				 off_t count)
+{
+	if (!hash_init (&index->names, dir_index_hash, dir_index_less, NULL))
+		return false;
+	index->built = true;
+	for (off_t i = 0; i < count && index->built; i++)
+		if (entries[i].in_use)
+			dir_index_insert (index, &entries[i], i * sizeof *entries);
+	return index->built;
+}
+#endif
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -41,6 +145,12 @@ dir_create (disk_sector_t sector, size_t entry_cnt) {
 #ifndef FILESYS
 	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
 #else
+#ifdef EFILESYS
+	/* Jack - directories grow as entries are added, so a new one only
+	 * gets the slots that fit inline in its inode. */
+	if (entry_cnt > INODE_INLINE_BYTES / sizeof (struct dir_entry))
+		entry_cnt = INODE_INLINE_BYTES / sizeof (struct dir_entry);
+#endif
 	return inode_create (sector, entry_cnt * sizeof (struct dir_entry), F_DIR);
 #endif
 }
@@ -142,9 +252,43 @@ lookup(const struct dir *dir, const char *name,
 	off_t length = inode_length(dir->inode);
 	off_t entry_count = length / (sizeof e);
 
+#ifdef EFILESYS
+	/* Jack - large directories are looked up by hash. The caller
+	 * holds the index lock. */
+	struct dir_index *index = inode_dir_index (dir->inode);
+	ASSERT (lock_held_by_current_thread (&index->lock));
+	if (index->built) {
+		struct dir_index_entry key, *ie;
+		struct hash_elem *he;
+
+		if (strlen (name) > NAME_MAX)
+			return false;
+		strlcpy (key.e.name, name, sizeof key.e.name);
+		he = hash_find (&index->names, &key.elem);
+		if (he == NULL)
+			return false;
+		ie = hash_entry (he, struct dir_index_entry, elem);
+		if (ep != NULL)
+			*ep = ie->e;
+		if (ofsp != NULL)
+			*ofsp = ie->ofs;
+		return true;
+	}
+#endif
+
 	size_t pages = length % PGSIZE == 0? length / PGSIZE: length / PGSIZE + 1;
 	struct dir_entry *entries = palloc_get_multiple(PAL_ZERO, pages);
+	if (entries == NULL)
+		return false;
 	inode_read_at (dir->inode, entries, length, 0);
+
+#ifdef EFILESYS
+	if (entry_count >= DIR_INDEX_MIN_ENTRIES
+			&& dir_index_build (index, entries, entry_count)) {
+		palloc_free_multiple(entries, pages);
+		return lookup (dir, name, ep, ofsp);
+	}
+#endif
 	
 	for (ofs = 0; ofs != entry_count; ++ofs) {
 		e = entries[ofs];
@@ -174,10 +318,28 @@ bool dir_lookup(const struct dir *dir, const char *name,
 	ASSERT(dir != NULL);
 	ASSERT(name != NULL);
 
+#ifdef EFILESYS
+	/* Jack - try the dentry cache first. Results are cached under the
+	 * index lock, so they cannot race with dir_add() or dir_remove(). */
+	disk_sector_t dir_sector = inode_get_inumber (dir->inode);
+	bool found;
+
+	lock_acquire (&inode_dir_index (dir->inode)->lock);
+	if (dcache_lookup (dir_sector, name, &found, &e.inode_sector))
+		*inode = found? inode_open(e.inode_sector): NULL;
+	else {
+		found = lookup(dir, name, &e, NULL);
+		*inode = found? inode_open(e.inode_sector): NULL;
+		if (!inode_get_removed (dir->inode))
+			dcache_insert (dir_sector, name, found, e.inode_sector);
+	}
+	lock_release (&inode_dir_index (dir->inode)->lock);
+#else
 	if (lookup(dir, name, &e, NULL))
 		*inode = inode_open(e.inode_sector);
 	else
 		*inode = NULL;
+#endif
 
 	return *inode != NULL;
 }
@@ -202,6 +364,9 @@ bool dir_add(struct dir *dir, const char *name, disk_sector_t inode_sector, enum
 	if (*name == '\0' || strlen(name) > NAME_MAX)
 		return false;
 
+	struct dir_index *index = inode_dir_index (dir->inode); // Jack
+	lock_acquire (&index->lock);
+
 	/* Check that NAME is not in use. */
 	if (lookup(dir, name, NULL, NULL))
 		goto done;
@@ -212,8 +377,10 @@ bool dir_add(struct dir *dir, const char *name, disk_sector_t inode_sector, enum
 
 	 * inode_read_at() will only return a short read at end of file.
 	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
+	 * read due to something intermittent such as low memory.
+	 * Jack - the search starts at the free slot hint, not at 0. */
+	for (ofs = index->free_hint;
+		 inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
 		 ofs += sizeof e)
 		if (!e.in_use)
 			break;
@@ -224,8 +391,14 @@ bool dir_add(struct dir *dir, const char *name, disk_sector_t inode_sector, enum
 	e.inode_sector = inode_sector;
 	e.type = type; // eleshock
 	success = inode_write_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (success) {
+		index->free_hint = ofs + sizeof e;
+		dir_index_insert (index, &e, ofs);
+		dcache_invalidate (inode_get_inumber (dir->inode), name);
+	}
 
 done:
+	lock_release (&index->lock);
 	return success;
 }
 #else
@@ -302,6 +475,11 @@ bool dir_remove(struct dir *dir, const char *name)
 	ASSERT(dir != NULL);
 	ASSERT(name != NULL);
 
+#ifdef EFILESYS
+	struct dir_index *index = inode_dir_index (dir->inode); // Jack
+	lock_acquire (&index->lock);
+#endif
+
 	/* Find directory entry. */
 	if (!lookup(dir, name, &e, &ofs))
 		goto done;
@@ -338,11 +516,23 @@ bool dir_remove(struct dir *dir, const char *name)
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
 
+#ifdef EFILESYS
+	dir_index_delete (index, name);
+	if (ofs < index->free_hint)
+		index->free_hint = ofs;
+	dcache_invalidate (inode_get_inumber (dir->inode), name);
+	if (e.type == F_DIR)
+		dcache_purge_dir (e.inode_sector);
+#endif
+
 	/* Remove inode. */
 	inode_remove (inode);
 	success = true;
 
 done:
+#ifdef EFILESYS
+	lock_release (&index->lock);
+#endif
 	inode_close (inode);
 	return success;
 }
@@ -353,19 +543,24 @@ done:
 bool dir_readdir(struct dir *dir, char name[NAME_MAX + 1])
 {
 	struct dir_entry e;
+	struct lock *lock = &inode_dir_index (dir->inode)->lock;
+	bool found = false;
 
 	/* eleshock */
 
+	lock_acquire (lock); // Jack
 	while (inode_read_at(dir->inode, &e, sizeof e, dir->pos) == sizeof e)
 	{
 		dir->pos += sizeof e;
 		if (e.in_use && (strchr(".", *e.name) == NULL))
 		{
 			strlcpy(name, e.name, NAME_MAX + 1);
-			return true;
+			found = true;
+			break;
 		}
 	}
-	return false;
+	lock_release (lock);
+	return found;
 }
 
 /* Jack */
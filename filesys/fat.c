@@ -1,8 +1,11 @@
 #include "filesys/fat.h"
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include <bitmap.h>
 #include <stdio.h>
 #include <string.h>
 #include "filesys/directory.h" // yeopto
@@ -10,11 +13,14 @@
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */
+	unsigned int sectors_per_cluster; /* Chosen at format time. Jack */
 	unsigned int total_sectors;
 	unsigned int fat_start;
 	unsigned int fat_sectors; /* Size of FAT in sectors. */
 	unsigned int root_dir_cluster;
+	unsigned int layout; /* enum fs_layout of new files. Jack */
+	unsigned int journal_start; /* Journal region, after the FAT. Jack */
+	unsigned int journal_sectors; /* 0 if there is no journal. */
 };
 
 /* FAT FS */
@@ -24,15 +30,33 @@ struct fat_fs {
 	unsigned int fat_length;
 	disk_sector_t data_start;
 	cluster_t last_clst;
-	struct lock write_lock;
-	struct lock read_lock; // Jack
-	unsigned int read_count; // Jack
+	struct rwlock lock; // Jack - writers change the FAT, readers walk it
+
+	/* Jack - allocation, protected by LOCK held for writing */
+	struct bitmap *used_map;	/* Clusters whose FAT entry is not 0. */
+	cluster_t next_fit;			/* Where the next search starts. */
+	struct bitmap *dirty_map;	/* FAT sectors changed since fat_flush(). */
+
+	/* Jack - clusters freed while the journal holds frees back, also
+	 * protected by LOCK; see fat_hold_frees() */
+	struct bitmap *freed_map;	/* Freed by the running transaction. */
+	struct bitmap *limbo_map;	/* Freed by committed transactions. */
+	cluster_t held_cnt;			/* Clusters in either map. */
 };
 
 static struct fat_fs *fat_fs;
 
+/* Jack */
+/* The next cluster in the FAT entry VAL, without FAT_UNWRITTEN. */
+#define FAT_NEXT(VAL) ((VAL) & ~FAT_UNWRITTEN)
+
+/* Jack - FAT sectors handed to the buffer cache. */
+static long long fat_write_cnt;
+
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_used_map_init (void);
+static void fat_dirty_init (bool dirty);
 
 void
 fat_init (void) {
@@ -41,12 +65,7 @@ fat_init (void) {
 		PANIC ("FAT init failed");
 
 	// Read boot sector from the disk
-	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT init failed");
-	disk_read (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	memcpy (&fat_fs->bs, bounce, sizeof (fat_fs->bs));
-	free (bounce);
+	buffer_cache_read (FAT_BOOT_SECTOR, &fat_fs->bs, 0, sizeof (fat_fs->bs));
 
 	// Extract FAT info
 	if (fat_fs->bs.magic != FAT_MAGIC)
@@ -54,33 +73,53 @@ fat_init (void) {
 	fat_fs_init ();
 }
 
+/* Jack */
+/* Bytes of the FAT held by FAT sector IDX. */
+static off_t
+fat_sector_bytes (size_t idx) {
+	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
+	off_t bytes_left = fat_size_in_bytes - (off_t) idx * DISK_SECTOR_SIZE;
+
+	return bytes_left < DISK_SECTOR_SIZE? bytes_left: DISK_SECTOR_SIZE;
+}
+
 void
 fat_open (void) {
+	free (fat_fs->fat);
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT load failed");
 
-	// Load FAT directly from the disk
+	// Load FAT through the buffer cache, which may still hold the
+	// sectors fat_create() just wrote
 	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
+	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++)
+		buffer_cache_read (fat_fs->bs.fat_start + i,
+		                   buffer + i * DISK_SECTOR_SIZE, 0,
+		                   fat_sector_bytes (i));
+	fat_dirty_init (false);
+	fat_used_map_init ();
+}
+
+/* Jack */
+/* Hands the dirty FAT sectors to the buffer cache, which writes them
+ * behind, or to the journal while there is one. Called whenever
+ * clusters are freed, so a freed cluster does not turn up as used
+ * again after a crash, on each commit and on fat_close(). */
+void
+fat_flush (void) {
+	uint8_t *buffer = (uint8_t *) fat_fs->fat;
+	size_t i = 0;
+
+	rwlock_acquire_write(&fat_fs->lock);
+	while ((i = bitmap_scan_and_flip (fat_fs->dirty_map, i, 1, true))
+			!= BITMAP_ERROR) {
+		buffer_cache_write_meta (fat_fs->bs.fat_start + i,
+		                         buffer + i * DISK_SECTOR_SIZE, 0,
+		                         fat_sector_bytes (i));
+		fat_write_cnt++;
 	}
+	rwlock_release_write(&fat_fs->lock);
 }
 
 void
@@ -90,30 +129,18 @@ fat_close (void) {
 	if (bounce == NULL)
 		PANIC ("FAT close failed");
 	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
+	buffer_cache_write (FAT_BOOT_SECTOR, bounce, 0, DISK_SECTOR_SIZE);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	// Write the FAT sectors that changed since the last flush
+	fat_flush ();
+}
+
+/* Jack */
+/* Prints FAT statistics. */
+void
+fat_print_stats (void) {
+	printf ("FAT: %lld sectors written\n", fat_write_cnt);
 }
 
 void
@@ -126,12 +153,14 @@ fat_create (void) {
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
+	fat_dirty_init (true);
+	fat_used_map_init ();
 
 	// Set up ROOT_DIR_CLST
 	/* prj4 filesys - yeopto */
-	lock_acquire(&fat_fs->write_lock);
+	rwlock_acquire_write(&fat_fs->lock);
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
-	lock_release(&fat_fs->write_lock);
+	rwlock_release_write(&fat_fs->lock);
 
 	// Jack
 	// root dir 위치에 inode 없이 directory로 쓴다? 어쩌자는거지? 그냥 inode만드는 방식으로 바꿀래...
@@ -156,14 +185,24 @@ void
 fat_boot_create (void) {
 	unsigned int fat_sectors =
 	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * format_cluster_sectors + 1) + 1;
+	/* Jack - a sixteenth of the disk goes to the journal, up to
+	 * JOURNAL_SECTORS */
+	unsigned int journal_sectors = disk_size (filesys_disk) / 16;
+	if (journal_sectors > JOURNAL_SECTORS)
+		journal_sectors = JOURNAL_SECTORS;
+	if (journal_sectors < JOURNAL_MIN_SECTORS)
+		journal_sectors = 0;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = format_cluster_sectors,
 	    .total_sectors = disk_size (filesys_disk),
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
 	    .root_dir_cluster = ROOT_DIR_CLUSTER,
+	    .layout = format_layout,
+	    .journal_start = 1 + fat_sectors,
+	    .journal_sectors = journal_sectors,
 	};
 }
 
@@ -171,17 +210,129 @@ fat_boot_create (void) {
 void
 fat_fs_init (void) {
 	/* TODO: Your code goes here. */
-	fat_fs->fat_length = fat_fs->bs.total_sectors - fat_fs->bs.fat_sectors - 1;
-	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
-	fat_fs->read_count = 0;
-	lock_init(&fat_fs->write_lock);
-	lock_init(&fat_fs->read_lock);
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->bs.fat_sectors
+			- fat_fs->bs.journal_sectors - 1)
+		/ fat_fs->bs.sectors_per_cluster; // Jack
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors
+		+ fat_fs->bs.journal_sectors; // Jack
+	rwlock_init(&fat_fs->lock);
+}
+
+/* Jack */
+/* Builds the map of used clusters from the FAT. Cluster 0 means "no
+ * cluster" and is never handed out. */
+static void
+fat_used_map_init (void) {
+	if (fat_fs->used_map != NULL)
+		bitmap_destroy (fat_fs->used_map);
+	fat_fs->used_map = bitmap_create (fat_fs->fat_length);
+	if (fat_fs->used_map == NULL)
+		PANIC ("FAT used map creation failed");
+	for (cluster_t i = 0; i < fat_fs->fat_length; i++)
+		if (fat_fs->fat[i] != 0)
+			bitmap_mark (fat_fs->used_map, i);
+	bitmap_mark (fat_fs->used_map, 0);
+	fat_fs->next_fit = 2;
+}
+
+/* Jack */
+/* Sets up tracking of changed FAT sectors. A FAT built in memory by
+ * fat_create() is DIRTY as a whole; one loaded by fat_open() is not. */
+static void
+fat_dirty_init (bool dirty) {
+	if (fat_fs->dirty_map != NULL)
+		bitmap_destroy (fat_fs->dirty_map);
+	fat_fs->dirty_map = bitmap_create (fat_fs->bs.fat_sectors);
+	if (fat_fs->dirty_map == NULL)
+		PANIC ("FAT dirty map creation failed");
+	bitmap_set_all (fat_fs->dirty_map, dirty);
 }
 
 /*----------------------------------------------------------------------------*/
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 
+/* Jack */
+/* Finds CNT free clusters in a row. HINT, if not 0, is tried first so
+ * a growing chain stays contiguous; otherwise the search is next fit,
+ * starting where the last one ended. Returns the first cluster of
+ * the run, or 0 if there is none. The FAT must be held for writing. */
+static cluster_t
+fat_find_run (cluster_t cnt, cluster_t hint) {
+	size_t idx = BITMAP_ERROR;
+
+	if (hint != 0 && hint + cnt <= fat_fs->fat_length
+			&& bitmap_none (fat_fs->used_map, hint, cnt))
+		idx = hint;
+	if (idx == BITMAP_ERROR)
+		idx = bitmap_scan (fat_fs->used_map, fat_fs->next_fit, cnt, false);
+	if (idx == BITMAP_ERROR)
+		idx = bitmap_scan (fat_fs->used_map, 0, cnt, false);
+	if (idx == BITMAP_ERROR)
+		return 0;
+
+	fat_fs->next_fit = idx + cnt < fat_fs->fat_length? idx + cnt: 2;
+	return idx;
+}
+
+/* Jack */
+/* Allocates a run of CNT contiguous clusters, at HINT if it is free,
+ * for a file that maps its clusters itself (FS_LAYOUT_EXTENT). The run
+ * is linked as a chain only so that the FAT shows it in use. Returns
+ * its first cluster, or 0 if there is no free run of CNT clusters. */
+cluster_t
+fat_alloc_run (cluster_t hint, cluster_t cnt) {
+	cluster_t first;
+
+	ASSERT (cnt > 0);
+
+	rwlock_acquire_write(&fat_fs->lock);
+	first = fat_find_run (cnt, hint);
+	if (first != 0)
+		for (cluster_t i = 0; i < cnt; i++)
+			fat_put (first + i,
+					(i + 1 < cnt? first + i + 1: EOChain) | FAT_UNWRITTEN);
+	rwlock_release_write(&fat_fs->lock);
+	return first;
+}
+
+/* Jack */
+/* Frees the CNT clusters starting at START, which fat_alloc_run()
+ * handed out, possibly over several calls. */
+void
+fat_free_run (cluster_t start, cluster_t cnt) {
+	rwlock_acquire_write(&fat_fs->lock);
+	for (cluster_t i = 0; i < cnt; i++)
+		fat_put (start + i, 0);
+	rwlock_release_write(&fat_fs->lock);
+	fat_flush ();
+}
+
+/* Jack */
+/* Allocates CNT contiguous clusters as one chain, appended to CLST
+ * unless CLST is 0. Returns the first new cluster, or 0 if there is no
+ * free run of CNT clusters. New clusters are FAT_UNWRITTEN. */
+cluster_t
+fat_create_contig_chain (cluster_t clst, cluster_t cnt) {
+	cluster_t first;
+
+	ASSERT (cnt > 0);
+
+	rwlock_acquire_write(&fat_fs->lock);
+	first = fat_find_run (cnt, clst != 0? clst + 1: 0);
+	if (first != 0) {
+		for (cluster_t i = 0; i < cnt; i++)
+			fat_put (first + i,
+					(i + 1 < cnt? first + i + 1: EOChain) | FAT_UNWRITTEN);
+		if (clst != 0) {
+			ASSERT(FAT_NEXT (fat_fs->fat[clst]) == EOChain);
+			fat_put (clst, first | (fat_fs->fat[clst] & FAT_UNWRITTEN));
+		}
+	}
+	rwlock_release_write(&fat_fs->lock);
+	return first;
+}
+
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
  * Returns 0 if fails to allocate a new cluster. */
@@ -189,54 +340,50 @@ cluster_t
 fat_create_chain (cluster_t clst) {
 	/* TODO: Your code goes here. */
 
-	/* eleshock */
-	lock_acquire(&fat_fs->write_lock);
-	cluster_t i = 2;
-	while (fat_fs->fat[i] != 0 && i < fat_fs->fat_length) {
-		++i;
-	}
-	
-	if (i == fat_fs->fat_length) {
-		i = 0;
-		goto done;
-	}
-	
-	fat_put(i, EOChain);
-	
-	if (clst == 0) {
-		goto done;
-	}
-
-	ASSERT(fat_fs->fat[clst] == EOChain);
-	
-	fat_put(clst, i);
-done:
-	lock_release(&fat_fs->write_lock);
-	return i;
+	/* Jack */
+	return fat_create_contig_chain (clst, 1);
 }
 
 /* Jack */
 /* Add clusters to the chain.
  * If CLST is 0, start a new chain.
  * If CLSTP is not NULL, save first cluster number to it
- * Returns false if fails to allocate a new cluster */
+ * If TAILP is not NULL, save last cluster number to it
+ * Returns false if fails to allocate a new cluster.
+ * The clusters are taken in one run if possible, otherwise in runs
+ * that halve in length until they fit. */
 bool
-fat_create_multi_chain (cluster_t clst, cluster_t size, cluster_t *clstp) {
-	cluster_t first_clst = clst == 0? fat_create_chain(0) : fat_create_chain(clst);
-	if (first_clst == 0) return false;
+fat_create_multi_chain (cluster_t clst, cluster_t size, cluster_t *clstp,
+		cluster_t *tailp) {
+	cluster_t first_clst = 0, tail = clst;
+	cluster_t left = size, run = size;
 
-	cluster_t next_clst = first_clst;
-	for (int i = 0; i < size - 1; i++)
+	while (left > 0)
 	{
-		next_clst = fat_create_chain(next_clst);
-		if (next_clst == 0)
+		cluster_t got;
+
+		if (run > left)
+			run = left;
+		if ((got = fat_create_contig_chain(tail, run)) == 0)
 		{
-			fat_remove_chain(first_clst, clst);
-			return false;
+			if (run == 1)
+			{
+				if (first_clst != 0)
+					fat_remove_chain(first_clst, clst);
+				return false;
+			}
+			run /= 2;
+			continue;
 		}
+		if (first_clst == 0)
+			first_clst = got;
+		tail = got + run - 1;
+		left -= run;
 	}
 	if (clstp != NULL)
 		*clstp = first_clst;
+	if (tailp != NULL)
+		*tailp = tail;
 
 	return true;
 }
@@ -250,21 +397,21 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	/* prj4 filesys - yeopto */
 	cluster_t tmp_clst = clst;
 	
-	lock_acquire(&fat_fs->write_lock);
+	rwlock_acquire_write(&fat_fs->lock);
 	
-	while (fat_fs->fat[tmp_clst] != EOChain) {
-		cluster_t temp = fat_fs->fat[tmp_clst];
+	while (FAT_NEXT (fat_fs->fat[tmp_clst]) != EOChain) {
+		cluster_t temp = FAT_NEXT (fat_fs->fat[tmp_clst]);
 		fat_put(tmp_clst, 0);
 		tmp_clst = temp;
 	}
-	if (fat_fs->fat[tmp_clst] == EOChain)
+	if (FAT_NEXT (fat_fs->fat[tmp_clst]) == EOChain)
 		fat_put(tmp_clst, 0);
 
 	if (pclst != 0)
-		fat_put(pclst, EOChain);
+		fat_put(pclst, EOChain | (fat_fs->fat[pclst] & FAT_UNWRITTEN));
 
-	lock_release(&fat_fs->write_lock);
-	fat_close();
+	rwlock_release_write(&fat_fs->lock);
+	fat_flush ();
 }
 
 /* Update a value in the FAT table. */
@@ -273,6 +420,16 @@ fat_put (cluster_t clst, cluster_t val) {
 	/* TODO: Your code goes here. */
 	/* prj4 filesys - yeopto */
 	fat_fs->fat[clst] = val;
+	/* Jack - a cluster the journal holds back stays in USED_MAP */
+	if (val == 0 && fat_fs->freed_map != NULL) {
+		if (!bitmap_test (fat_fs->freed_map, clst)) {
+			bitmap_mark (fat_fs->freed_map, clst);
+			fat_fs->held_cnt++;
+		}
+	} else
+		bitmap_set (fat_fs->used_map, clst, val != 0); // Jack
+	bitmap_mark (fat_fs->dirty_map,
+	             clst * sizeof (cluster_t) / DISK_SECTOR_SIZE); // Jack
 }
 
 /* Jack */
@@ -282,21 +439,116 @@ fat_get (cluster_t clst) {
 	/* TODO: Your code goes here. */
 	cluster_t ret;
 
-	// lock_acquire(&fat_fs->read_lock);
-	// fat_fs->read_count++;
-	// if (fat_fs->read_count == 1)
-	lock_acquire(&fat_fs->write_lock);
-	// lock_release(&fat_fs->read_lock);
+	rwlock_acquire_read(&fat_fs->lock);
+	ret = FAT_NEXT (fat_fs->fat[clst]);
+	rwlock_release_read(&fat_fs->lock);
 
-	ret = fat_fs->fat[clst];
+	return ret;
+}
 
-	// lock_acquire(&fat_fs->read_lock);
-	// fat_fs->read_count--;
-	// if (fat_fs->read_count == 0)
-	lock_release(&fat_fs->write_lock);
-	// lock_release(&fat_fs->read_lock);
+/* Jack */
+/* Returns whether no data has been written to CLST since it was
+ * allocated, so that it reads as zeros. */
+bool
+fat_is_unwritten (cluster_t clst) {
+	bool unwritten;
 
-	return ret;
+	rwlock_acquire_read(&fat_fs->lock);
+	unwritten = (fat_fs->fat[clst] & FAT_UNWRITTEN) != 0;
+	rwlock_release_read(&fat_fs->lock);
+
+	return unwritten;
+}
+
+/* Jack */
+/* Records that CLST now holds data on disk. */
+void
+fat_set_written (cluster_t clst) {
+	rwlock_acquire_write(&fat_fs->lock);
+	if (fat_fs->fat[clst] & FAT_UNWRITTEN)
+		fat_put (clst, FAT_NEXT (fat_fs->fat[clst]));
+	rwlock_release_write(&fat_fs->lock);
+}
+
+/* Jack */
+/* Keeps clusters that are freed from now on in use until
+ * fat_release_frees() is called after the transaction freeing them is
+ * checkpointed. Until then, replaying the journal after a crash could
+ * still write old metadata over whatever a reused cluster came to
+ * hold. */
+void
+fat_hold_frees (void) {
+	fat_fs->freed_map = bitmap_create (fat_fs->fat_length);
+	fat_fs->limbo_map = bitmap_create (fat_fs->fat_length);
+	if (fat_fs->freed_map == NULL || fat_fs->limbo_map == NULL)
+		PANIC ("FAT free tracking failed");
+	fat_fs->held_cnt = 0;
+}
+
+/* Jack */
+/* Hands the clusters freed so far to the transaction being committed. */
+void
+fat_commit_frees (void) {
+	size_t i = 0;
+
+	rwlock_acquire_write(&fat_fs->lock);
+	while ((i = bitmap_scan_and_flip (fat_fs->freed_map, i, 1, true))
+			!= BITMAP_ERROR)
+		bitmap_mark (fat_fs->limbo_map, i);
+	rwlock_release_write(&fat_fs->lock);
+}
+
+/* Jack */
+/* Lets the clusters freed by committed transactions be reused, once
+ * those transactions are checkpointed. */
+void
+fat_release_frees (void) {
+	size_t i = 0;
+
+	rwlock_acquire_write(&fat_fs->lock);
+	while ((i = bitmap_scan_and_flip (fat_fs->limbo_map, i, 1, true))
+			!= BITMAP_ERROR) {
+		bitmap_reset (fat_fs->used_map, i);
+		fat_fs->held_cnt--;
+	}
+	rwlock_release_write(&fat_fs->lock);
+}
+
+/* Jack */
+/* Returns the number of free clusters held back for the journal. */
+cluster_t
+fat_held_cnt (void) {
+	return fat_fs->held_cnt;
+}
+
+/* Jack */
+/* Stores the first sector and the size of the journal region in *START
+ * and *CNT. *CNT is 0 on a disk formatted without one. */
+void
+fat_journal_region (disk_sector_t *start, size_t *cnt) {
+	*start = fat_fs->bs.journal_start;
+	*cnt = fat_fs->bs.journal_sectors;
+}
+
+/* Jack */
+/* Returns the layout that new files get. */
+enum fs_layout
+fat_layout (void) {
+	return fat_fs->bs.layout;
+}
+
+/* Jack */
+/* Returns the number of sectors in a cluster. */
+unsigned
+fat_cluster_sectors (void) {
+	return fat_fs->bs.sectors_per_cluster;
+}
+
+/* Jack */
+/* Returns the number of clusters the FAT describes. */
+cluster_t
+fat_cluster_cnt (void) {
+	return fat_fs->fat_length;
 }
 
 /* Covert a cluster # to a sector number. */
@@ -304,7 +556,8 @@ disk_sector_t
 cluster_to_sector (cluster_t clst) {
 	/* TODO: Your code goes here. */
 	/* prj4 filesys - yeopto */
-	disk_sector_t sector_num = fat_fs->data_start + clst;
+	disk_sector_t sector_num = fat_fs->data_start
+		+ clst * fat_fs->bs.sectors_per_cluster; // Jack
 
 	return sector_num;
 }
@@ -313,5 +566,5 @@ cluster_to_sector (cluster_t clst) {
 /* Convert a sector # to a cluster number */
 cluster_t
 sector_to_cluster (disk_sector_t sector) {
-	return sector - fat_fs->data_start;
+	return (sector - fat_fs->data_start) / fat_fs->bs.sectors_per_cluster;
 }
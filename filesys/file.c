@@ -2,6 +2,8 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file {
@@ -9,9 +11,52 @@ struct file {
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
 	bool is_dir;				/* prj4 filesys - yeopto */
-	struct dir *dir				/* prj5 filesys - yeopto */
+	struct dir *dir;			/* prj5 filesys - yeopto */
+	/* Jack - read-ahead state of a sequential reader. */
+	off_t ra_next;              /* Where a sequential read would start. */
+	off_t ra_window;            /* Bytes to keep read ahead, 0 for none. */
+	off_t ra_issued;            /* End of the read-ahead requested. */
 };
 
+#ifdef EFILESYS
+/* Jack */
+/* First and largest read-ahead window, in bytes. */
+#define READ_AHEAD_MIN (4 * 1024)
+#define READ_AHEAD_MAX (64 * 1024)
+
+/* Notes that FILE was just read from OFS up to its position. A read
+ * that starts where the last one ended doubles the read-ahead window,
+ * up to READ_AHEAD_MAX, and once half the window has been used up the
+ * rest of it is handed to the read-ahead worker. Any other read halves
+ * the window. */
+static void
+file_track_read (struct file *file, off_t ofs) {
+	off_t end;
+
+	if (file->pos == ofs)
+		return;
+	if (ofs != file->ra_next) {
+		file->ra_window /= 2;
+		file->ra_next = file->ra_issued = file->pos;
+		return;
+	}
+
+	file->ra_next = file->pos;
+	if (file->ra_window == 0)
+		file->ra_window = READ_AHEAD_MIN;
+	else if (file->ra_window < READ_AHEAD_MAX)
+		file->ra_window *= 2;
+	if (file->ra_issued < file->pos)
+		file->ra_issued = file->pos;
+
+	end = file->pos + file->ra_window;
+	if (end - file->ra_issued >= file->ra_window / 2) {
+		inode_read_ahead (file->inode, file->ra_issued, end - file->ra_issued);
+		file->ra_issued = end;
+	}
+}
+#endif
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
@@ -75,6 +120,9 @@ off_t
 file_read (struct file *file, void *buffer, off_t size) {
 	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
+#ifdef EFILESYS
+	file_track_read (file, file->pos - bytes_read); // Jack
+#endif
 	return bytes_read;
 }
 
@@ -115,6 +163,39 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Jack */
+/* Copies up to SIZE bytes from IN, starting at its position, to OUT at
+ * its position, advancing both. The data moves a page at a time from
+ * IN's page cache to OUT's without passing through user memory; each
+ * step reads at most one page of IN. Returns the number of bytes
+ * copied, which is less than SIZE at the end of IN or if OUT cannot
+ * grow, or -1 if memory runs out. */
+off_t
+file_copy (struct file *out, struct file *in, off_t size) {
+	uint8_t *bounce = palloc_get_page (0);
+	off_t copied = 0;
+
+	if (bounce == NULL)
+		return -1;
+	while (size > 0) {
+		off_t chunk = PGSIZE - pg_ofs (in->pos);
+		off_t got, put;
+
+		if (chunk > size)
+			chunk = size;
+		got = file_read (in, bounce, chunk);
+		put = file_write (out, bounce, got);
+		copied += put;
+		size -= put;
+		if (put < got)
+			in->pos -= got - put;
+		if (got < chunk || put < got)
+			break;
+	}
+	palloc_free_page (bounce);
+	return copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
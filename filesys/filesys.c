@@ -7,6 +7,9 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/dcache.h"
+#include "filesys/journal.h"
 
 /* eleshock */
 #include "filesys/fat.h"
@@ -15,6 +18,12 @@
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
+#ifdef EFILESYS
+/* Jack */
+enum fs_layout format_layout = FS_LAYOUT_FAT;
+unsigned format_cluster_sectors = SECTORS_PER_CLUSTER;
+#endif
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -25,14 +34,17 @@ filesys_init (bool format) {
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+	buffer_cache_init ();
 	inode_init ();
 
 #ifdef EFILESYS
+	dcache_init ();
 	fat_init ();
 
 	if (format)
 		do_format ();
 
+	journal_init (format); // Jack
 	fat_open ();
 	thread_current()->working_dir = dir_open_root();
 #else
@@ -50,12 +62,15 @@ filesys_init (bool format) {
  * to disk. */
 void
 filesys_done (void) {
+	inode_done ();
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close ();
+	journal_done (); // Jack
 #else
 	free_map_close ();
 #endif
+	buffer_cache_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -66,6 +81,7 @@ bool
 filesys_create (const char *name, off_t initial_size) {
 /* eleshock && Jack */
 #ifdef EFILESYS
+	journal_begin (); // Jack
 	struct dir *dir = dir_reopen(thread_current()->working_dir);
 	cluster_t clst = fat_create_chain (0);
 	bool success = (dir != NULL
@@ -84,6 +100,9 @@ filesys_create (const char *name, off_t initial_size) {
 		free_map_release (inode_sector, 1);
 #endif
 	dir_close (dir);
+#ifdef EFILESYS
+	journal_end ();
+#endif
 
 	return success;
 }
@@ -111,10 +130,12 @@ filesys_open (const char *name) {
  * or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) {
+	journal_begin (); // Jack
 	struct dir *dir = dir_reopen(thread_current()->working_dir);
 	bool success = dir != NULL && dir_remove (dir, name);
 
 	dir_close (dir);
+	journal_end ();
 
 	return success;
 }
@@ -1,4 +1,5 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
@@ -7,10 +8,37 @@
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "filesys/fat.h" /* eleshock */
+#include "filesys/buffer_cache.h"
+#include "filesys/journal.h"
+#ifdef EFILESYS
+#include "vm/vm.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+#ifdef EFILESYS
+/* Jack */
+/* A run of LEN clusters starting at START. */
+struct extent {
+	cluster_t start;
+	uint32_t len;
+};
+
+/* Extents held in an inode, and in each indirect extent block. */
+#define INODE_EXTENTS 60
+#define BLOCK_EXTENTS 63
+
+/* Indirect extent block, in the first sector of a cluster. A file
+ * with more than INODE_EXTENTS extents chains these from
+ * inode_disk.indirect. */
+struct extent_block {
+	cluster_t next;                     /* Next block, or 0. */
+	uint32_t unused;                    /* Not used. */
+	struct extent extents[BLOCK_EXTENTS];
+};
+#endif
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
@@ -20,7 +48,20 @@ struct inode_disk {
 	enum file_type type; // Jack
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[124];               /* Not used. */
+	/* Jack - an FS_LAYOUT_FAT file follows the FAT chain from START;
+	 * an FS_LAYOUT_EXTENT file lists its clusters in extents, and
+	 * START is that of the first extent. An INODE_INLINE file has no
+	 * clusters: its data is kept where the extents would be. */
+	uint16_t layout;                    /* enum fs_layout. */
+	uint16_t flags;                     /* INODE_* flags. */
+	uint32_t extent_cnt;                /* Number of extents. */
+	cluster_t indirect;                 /* First extent_block, or 0. */
+	union {
+		struct extent extents[INODE_EXTENTS];
+		uint8_t inline_data[INODE_INLINE_BYTES];
+	};
+	uint32_t alloc_cnt;                 /* Clusters allocated, if more
+	                                       than LENGTH needs. */
 #else
 	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
@@ -29,6 +70,11 @@ struct inode_disk {
 #endif
 };
 
+#ifdef EFILESYS
+/* inode_disk.flags. */
+#define INODE_INLINE 0x1                /* Data is in the inode. */
+#endif
+
 /* Returns the number of sectors to allocate for an inode SIZE
  * bytes long. */
 static inline size_t
@@ -36,39 +82,522 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
+#ifdef EFILESYS
+/* Jack */
+/* Returns the number of bytes in a cluster. */
+static inline off_t
+cluster_bytes (void) {
+	return fat_cluster_sectors () * DISK_SECTOR_SIZE;
+}
+
+/* Returns the number of clusters to allocate for an inode SIZE bytes
+ * long, which is at least one. */
+static inline size_t
+bytes_to_clusters (off_t size) {
+	return size > 0? DIV_ROUND_UP (size, cluster_bytes ()): 1;
+}
+
+/* Returns whether D keeps its data in the inode sector. */
+static inline bool
+inode_is_inline (const struct inode_disk *d) {
+	return (d->flags & INODE_INLINE) != 0;
+}
+
+/* Cluster numbers per block of an inode's cluster map. */
+#define CMAP_BLOCK 256
+
+/* Most bytes allocated ahead of a growing file. */
+#define PREALLOC_BYTES (64 * 1024)
+#endif
+
+/* Jack */
+/* Number of inodes kept in memory after their last close. */
+#define INODE_CACHE_SIZE 64
+
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in inode table. */
+	struct list_elem lru_elem;          /* Element in closed_inodes. */
 	int open_cnt;                       /* Number of openers. */
+	bool busy;                          /* Being read in, trimmed or
+	                                       freed. Jack */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 /* prj4 filesys - yeopto */
 #ifdef EFILESYS
 	cluster_t cluster;
+	struct page_cache_set pages;        /* Cached data pages. Jack */
+
+	/* Jack - the first CMAP_CNT clusters of the file's chain, in order,
+	 * CMAP_BLOCK to a block. Entries are appended, and only those past
+	 * the end of the file are ever dropped, so readers of entries
+	 * below CMAP_CNT need no lock. */
+	cluster_t **cmap;
+	size_t cmap_cnt;
+	struct lock cmap_lock;              /* Serializes filling CMAP. */
+	struct dir_index dir_index;         /* Name index, for directories. */
+	cluster_t tail;                     /* Last cluster of a FS_LAYOUT_FAT
+	                                       file's chain, 0 if unknown. */
+	bool dirty;                         /* DATA not yet in the inode's
+	                                       sector. */
+	struct lock lock;                   /* Serializes growth, inline data
+	                                       and claiming clusters. */
 #else	
 	disk_sector_t sector;               /* Sector number of disk location. */
 #endif
 	struct inode_disk data;             /* Inode content. */
 };
 
+#ifdef EFILESYS
+/* Jack */
+/* Extents of an FS_LAYOUT_EXTENT inode D are numbered from 0. The
+ * first INODE_EXTENTS live in D itself, the rest in indirect blocks.
+ * Changes to D are written out by the caller along with the rest of
+ * the inode; changes to indirect blocks go to the buffer cache. */
+
+static cluster_t inode_cluster (struct inode *, size_t idx);
+
+/* Returns the indirect block after BLK. */
+static cluster_t
+extent_block_next (cluster_t blk) {
+	cluster_t next;
+
+	buffer_cache_read (cluster_to_sector (blk), &next,
+			offsetof (struct extent_block, next), sizeof next);
+	return next;
+}
+
+/* Returns the indirect block holding extent K of D, which must be
+ * past the ones in D. */
+static cluster_t
+extent_block_at (const struct inode_disk *d, size_t k) {
+	cluster_t blk = d->indirect;
+
+	ASSERT (k >= INODE_EXTENTS);
+	for (size_t i = 0; i < (k - INODE_EXTENTS) / BLOCK_EXTENTS; i++)
+		blk = extent_block_next (blk);
+	return blk;
+}
+
+/* Returns the block holding extent K of D when BLK holds extent K - 1,
+ * for walking the extents in order. */
+static cluster_t
+extent_block_step (const struct inode_disk *d, cluster_t blk, size_t k) {
+	if (k < INODE_EXTENTS)
+		return 0;
+	if (k == INODE_EXTENTS)
+		return d->indirect;
+	if ((k - INODE_EXTENTS) % BLOCK_EXTENTS == 0)
+		return extent_block_next (blk);
+	return blk;
+}
+
+/* Reads extent K of D, which is in block BLK if it is indirect. */
+static void
+extent_read (const struct inode_disk *d, cluster_t blk, size_t k,
+		struct extent *e) {
+	if (k < INODE_EXTENTS)
+		*e = d->extents[k];
+	else
+		buffer_cache_read (cluster_to_sector (blk), e,
+				offsetof (struct extent_block, extents)
+				+ (k - INODE_EXTENTS) % BLOCK_EXTENTS * sizeof *e, sizeof *e);
+}
+
+/* Writes extent K of D, which is in block BLK if it is indirect. */
+static void
+extent_write (struct inode_disk *d, cluster_t blk, size_t k,
+		const struct extent *e) {
+	if (k < INODE_EXTENTS)
+		d->extents[k] = *e;
+	else
+		buffer_cache_write_meta (cluster_to_sector (blk), e,
+				offsetof (struct extent_block, extents)
+				+ (k - INODE_EXTENTS) % BLOCK_EXTENTS * sizeof *e, sizeof *e);
+}
+
+/* Returns the IDX'th cluster of D, which must exist. */
+static cluster_t
+extent_cluster (const struct inode_disk *d, size_t idx) {
+	cluster_t blk = 0;
+	struct extent e;
+
+	for (size_t k = 0; k < d->extent_cnt; k++) {
+		blk = extent_block_step (d, blk, k);
+		extent_read (d, blk, k, &e);
+		if (idx < e.len)
+			return e.start + idx;
+		idx -= e.len;
+	}
+	NOT_REACHED ();
+}
+
+/* Appends extent E to D, adding an indirect block if needed. Returns
+ * false if no cluster is left for the block. */
+static bool
+extent_append (struct inode_disk *d, const struct extent *e) {
+	size_t k = d->extent_cnt;
+	cluster_t blk = 0;
+
+	if (k >= INODE_EXTENTS && (k - INODE_EXTENTS) % BLOCK_EXTENTS == 0) {
+		static struct extent_block empty;
+
+		blk = fat_alloc_run (0, 1);
+		if (blk == 0)
+			return false;
+		buffer_cache_write_meta (cluster_to_sector (blk), &empty, 0,
+				DISK_SECTOR_SIZE);
+		if (k == INODE_EXTENTS)
+			d->indirect = blk;
+		else
+			buffer_cache_write_meta (
+					cluster_to_sector (extent_block_at (d, k - 1)),
+					&blk, offsetof (struct extent_block, next), sizeof blk);
+	} else if (k >= INODE_EXTENTS)
+		blk = extent_block_at (d, k);
+
+	extent_write (d, blk, k, e);
+	d->extent_cnt++;
+	return true;
+}
+
+/* Frees all clusters of D from the KEEP'th on, with the indirect blocks
+ * that are no longer needed. */
+static void
+extent_truncate (struct inode_disk *d, size_t keep) {
+	cluster_t blk = 0, prev;
+	size_t base = 0, kept = 0, blocks;
+	struct extent e;
+
+	for (size_t k = 0; k < d->extent_cnt; k++) {
+		blk = extent_block_step (d, blk, k);
+		extent_read (d, blk, k, &e);
+		if (base + e.len <= keep)
+			kept = k + 1;
+		else if (base < keep) {
+			uint32_t len = keep - base;
+			fat_free_run (e.start + len, e.len - len);
+			base += e.len;
+			e.len = len;
+			extent_write (d, blk, k, &e);
+			kept = k + 1;
+			continue;
+		} else
+			fat_free_run (e.start, e.len);
+		base += e.len;
+	}
+
+	/* Drop the indirect blocks past the last extent kept. */
+	blocks = kept > INODE_EXTENTS?
+		DIV_ROUND_UP (kept - INODE_EXTENTS, BLOCK_EXTENTS): 0;
+	prev = 0;
+	blk = d->indirect;
+	for (size_t i = 0; blk != 0; i++) {
+		cluster_t next = extent_block_next (blk);
+		if (i == blocks) {
+			cluster_t none = 0;
+			if (prev == 0)
+				d->indirect = 0;
+			else
+				buffer_cache_write_meta (cluster_to_sector (prev), &none,
+						offsetof (struct extent_block, next), sizeof none);
+		}
+		if (i >= blocks)
+			fat_free_run (blk, 1);
+		prev = blk;
+		blk = next;
+	}
+	d->extent_cnt = kept;
+	d->start = kept > 0? d->extents[0].start: 0;
+}
+
+/* Writes SIZE bytes from BUFFER at OFS within SECTOR, which holds
+ * data of the file whose on-disk inode is D. Only the data of regular
+ * files bypasses the journal. */
+static void
+inode_data_write (const struct inode_disk *d, disk_sector_t sector,
+		const void *buffer, off_t ofs, off_t size) {
+	if (d->type == F_ORD)
+		buffer_cache_write (sector, buffer, ofs, size);
+	else
+		buffer_cache_write_meta (sector, buffer, ofs, size);
+}
+
+/* Grows D from OLD_CNT to NEW_CNT clusters. Runs are taken as
+ * long as they can be, right after the last extent if possible, which
+ * then just gets longer. On failure D is left as it was. */
+static bool
+extent_grow (struct inode_disk *d, size_t old_cnt, size_t new_cnt) {
+	size_t left = new_cnt - old_cnt, run = left;
+	struct extent last = { 0, 0 };
+
+	if (d->extent_cnt > 0)
+		extent_read (d, d->extent_cnt > INODE_EXTENTS?
+				extent_block_at (d, d->extent_cnt - 1): 0,
+				d->extent_cnt - 1, &last);
+
+	while (left > 0) {
+		cluster_t first;
+
+		if (run > left)
+			run = left;
+		first = fat_alloc_run (last.len > 0? last.start + last.len: 0, run);
+		if (first == 0) {
+			if (run == 1)
+				goto fail;
+			run /= 2;
+			continue;
+		}
+		if (last.len > 0 && last.start + last.len == first) {
+			size_t k = d->extent_cnt - 1;
+			last.len += run;
+			extent_write (d, k >= INODE_EXTENTS? extent_block_at (d, k): 0,
+					k, &last);
+		} else {
+			last = (struct extent) { first, run };
+			if (!extent_append (d, &last)) {
+				fat_free_run (first, run);
+				goto fail;
+			}
+		}
+		left -= run;
+	}
+	d->start = d->extents[0].start;
+	return true;
+
+fail:
+	extent_truncate (d, old_cnt);
+	return false;
+}
+
+/* Grows the data of INODE, whose on-disk inode is D, from OLD_CNT to
+ * NEW_CNT clusters. INODE is NULL, and OLD_CNT 0, for an inode being
+ * created. Returns false if the disk is full.
+ * New clusters are not written: they are FAT_UNWRITTEN, read as zeros
+ * and have what the first write leaves out zeroed by
+ * inode_claim_cluster(). */
+static bool
+inode_grow (struct inode *inode, struct inode_disk *d, size_t old_cnt,
+		size_t new_cnt) {
+	cluster_t first, tail;
+	bool success;
+
+	ASSERT (new_cnt > old_cnt);
+	ASSERT (inode != NULL || old_cnt == 0);
+
+	if (d->layout == FS_LAYOUT_EXTENT)
+		return extent_grow (d, old_cnt, new_cnt);
+
+	if (old_cnt == 0)
+		success = fat_create_multi_chain (0, new_cnt, &d->start, &tail);
+	else
+		success = fat_create_multi_chain (inode->tail != 0? inode->tail:
+					inode_cluster (inode, old_cnt - 1),
+				new_cnt - old_cnt, &first, &tail);
+	if (success && inode != NULL)
+		inode->tail = tail;
+	return success;
+}
+
+/* Returns the number of clusters allocated to D. */
+static size_t
+inode_alloc_cnt (const struct inode_disk *d) {
+	size_t need = bytes_to_clusters (d->length);
+
+	if (inode_is_inline (d))
+		return 0;
+	return d->alloc_cnt > need? d->alloc_cnt: need;
+}
+
+/* Makes data cluster IDX of INODE ready for a write of bytes
+ * [FROM, TO) of the file, which lie in it. In a cluster that was never
+ * written, the sectors within the file that this write does not cover
+ * in full are zeroed first, so they read back as zeros; the covered
+ * ones are not, since the data lands on them anyway. Sectors past the
+ * end of file are left as they are: extend_file() zeroes whatever a
+ * later extension exposes, so a sequential writer writes no zeros. */
+static void
+inode_claim_cluster (struct inode *inode, size_t idx, off_t from, off_t to) {
+	static char zeros[DISK_SECTOR_SIZE];
+	cluster_t clst = inode_cluster (inode, idx);
+	off_t base = idx * cluster_bytes ();
+
+	if (!fat_is_unwritten (clst))
+		return;
+	lock_acquire (&inode->lock);
+	if (fat_is_unwritten (clst)) {
+		for (size_t i = 0; i < fat_cluster_sectors (); i++) {
+			off_t start = base + i * DISK_SECTOR_SIZE;
+			if (start >= inode->data.length)
+				break;
+			if (start < from || start + DISK_SECTOR_SIZE > to)
+				inode_data_write (&inode->data, cluster_to_sector (clst) + i,
+						zeros, 0, DISK_SECTOR_SIZE);
+		}
+		fat_set_written (clst);
+	}
+	lock_release (&inode->lock);
+}
+
+/* Moves the data of inline INODE out to CNT new clusters, in the
+ * layout it was created with. The new inode is built aside and put in
+ * place once the data is in its first cluster. Returns false, leaving
+ * INODE as it was, if the disk or memory is full.
+ * INODE's lock must be held. */
+static bool
+inode_uninline (struct inode *inode, size_t cnt) {
+	struct inode_disk *d = malloc (sizeof *d);
+	uint8_t *first = calloc (1, DISK_SECTOR_SIZE);
+
+	if (d == NULL || first == NULL) {
+		free (d);
+		free (first);
+		return false;
+	}
+	*d = inode->data;
+	d->flags &= ~INODE_INLINE;
+	memset (d->inline_data, 0, sizeof d->inline_data);
+	if (!inode_grow (inode, d, 0, cnt)) {
+		free (d);
+		free (first);
+		return false;
+	}
+	/* No one else can reach the cluster yet. Only its first sector is
+	 * written; the rest lies past the end of file. */
+	memcpy (first, inode->data.inline_data, inode->data.length);
+	inode_data_write (d, cluster_to_sector (d->start), first,
+			0, DISK_SECTOR_SIZE);
+	fat_set_written (d->start);
+	inode->data = *d;
+	free (d);
+	free (first);
+	return true;
+}
+
+/* Reads (or, if WRITE, writes) SIZE bytes of INODE's data at OFFSET
+ * from (to) BUFFER, within its length, if INODE is inline. Written
+ * data goes to the inode's sector straight away. Returns the number of
+ * bytes moved, or -1 if INODE is not inline. INODE's lock keeps it
+ * from moving to clusters meanwhile. */
+static off_t
+inode_inline_io (struct inode *inode, void *buffer, off_t size,
+		off_t offset, bool write) {
+	uint8_t *data = inode->data.inline_data;
+	off_t moved = -1;
+
+	lock_acquire (&inode->lock);
+	if (!inode_is_inline (&inode->data))
+		goto done;
+	moved = 0;
+	if (size <= 0 || offset >= inode->data.length)
+		goto done;
+	moved = size < inode->data.length - offset?
+		size: inode->data.length - offset;
+	if (!write)
+		memcpy (buffer, data + offset, moved);
+	else {
+		memcpy (data + offset, buffer, moved);
+		buffer_cache_write_meta (cluster_to_sector (inode->cluster), buffer,
+				offsetof (struct inode_disk, inline_data) + offset, moved);
+	}
+done:
+	lock_release (&inode->lock);
+	return moved;
+}
+
+/* Frees all data clusters of D. */
+static void
+inode_release_data (struct inode_disk *d) {
+	if (inode_is_inline (d))
+		return;
+	if (d->layout == FS_LAYOUT_EXTENT)
+		extent_truncate (d, 0);
+	else
+		fat_remove_chain (d->start, 0);
+}
+#endif
+
+#ifdef EFILESYS
+/* Jack */
+/* Returns the IDX'th cluster of INODE's data, which must exist.
+ * Clusters are looked up in the FAT once and remembered, so the walk
+ * down the chain is paid once per open inode instead of per access.
+ * The chain changes only past the end of the file: it grows there,
+ * and inode_trim() cuts it back on the last close and drops the
+ * entries it freed, so the entries for the file's data stay valid
+ * while the inode is in memory. */
+static cluster_t
+inode_cluster (struct inode *inode, size_t idx) {
+	cluster_t clst;
+
+	if (inode->data.layout == FS_LAYOUT_EXTENT)
+		return extent_cluster (&inode->data, idx);
+	if (idx == 0)
+		return inode->data.start;
+	if (idx < inode->cmap_cnt)
+		return inode->cmap[idx / CMAP_BLOCK][idx % CMAP_BLOCK];
+
+	lock_acquire (&inode->cmap_lock);
+	if (inode->cmap == NULL) {
+		size_t blocks = DIV_ROUND_UP (fat_cluster_cnt (), CMAP_BLOCK);
+		cluster_t **cmap = calloc (blocks, sizeof *cmap);
+		if (cmap == NULL)
+			goto walk;
+		barrier ();
+		inode->cmap = cmap;
+	}
+	while (inode->cmap_cnt <= idx) {
+		size_t i = inode->cmap_cnt;
+		cluster_t **block = &inode->cmap[i / CMAP_BLOCK];
+
+		if (*block == NULL)
+			*block = malloc (CMAP_BLOCK * sizeof **block);
+		if (*block == NULL)
+			goto walk;
+		(*block)[i % CMAP_BLOCK] = i == 0? inode->data.start:
+				fat_get (inode->cmap[(i - 1) / CMAP_BLOCK][(i - 1) % CMAP_BLOCK]);
+		/* The entry must be visible before the count that covers it. */
+		barrier ();
+		inode->cmap_cnt = i + 1;
+	}
+	lock_release (&inode->cmap_lock);
+	return inode->cmap[idx / CMAP_BLOCK][idx % CMAP_BLOCK];
+
+walk:
+	/* Out of memory: fall back to walking the chain. */
+	lock_release (&inode->cmap_lock);
+	clst = inode->data.start;
+	for (size_t i = 0; i < idx; i++)
+		clst = fat_get (clst);
+	return clst;
+}
+
+/* Jack */
+/* Frees INODE's cluster map. */
+static void
+inode_cmap_free (struct inode *inode) {
+	if (inode->cmap == NULL)
+		return;
+	for (size_t i = 0; i * CMAP_BLOCK < inode->cmap_cnt; i++)
+		free (inode->cmap[i]);
+	free (inode->cmap);
+	inode->cmap = NULL;
+	inode->cmap_cnt = 0;
+}
+#endif
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
 #ifdef EFILESYS
 	/* eleshock */
 	if (pos < inode->data.length)
-	{
-		cluster_t clst = inode->data.start; // first cluster idx
-		int count = pos / DISK_SECTOR_SIZE;
-		for (int i = 0; i < count; i++) {
-			clst = fat_get(clst);
-		}
-		return cluster_to_sector(clst);
-	}
+		return cluster_to_sector (inode_cluster (inode, pos / cluster_bytes ()))
+			+ pos % cluster_bytes () / DISK_SECTOR_SIZE; // Jack
 #else
 	if (pos < inode->data.length)
 		return inode->data.start + pos / DISK_SECTOR_SIZE;
@@ -78,36 +607,130 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* Jack */
-/* Extend file */
+/* Writes INODE's on-disk inode to its sector. */
+static void
+inode_write_disk (struct inode *inode) {
+	buffer_cache_write_meta (cluster_to_sector (inode->cluster), &inode->data,
+			0, DISK_SECTOR_SIZE);
+	inode->dirty = false;
+}
+
+/* Jack */
+/* Returns true if INODE has clusters allocated past its end. */
 static bool
-check_and_extend_file (struct inode *inode, off_t pos, off_t size) {
-	ASSERT (inode != NULL);
+inode_has_slack (const struct inode *inode) {
+	return inode->data.alloc_cnt > bytes_to_clusters (inode->data.length);
+}
+
+/* Jack */
+/* Gives back the clusters allocated past the end of INODE. INODE's
+ * lock must be held. */
+static void
+inode_trim (struct inode *inode) {
+	size_t keep = bytes_to_clusters (inode->data.length);
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	if (!inode_has_slack (inode))
+		return;
+	if (inode->data.layout == FS_LAYOUT_EXTENT)
+		extent_truncate (&inode->data, keep);
+	else {
+		fat_remove_chain (inode_cluster (inode, keep),
+				inode_cluster (inode, keep - 1));
+		/* The freed clusters drop out of the cluster map. */
+		lock_acquire (&inode->cmap_lock);
+		if (inode->cmap_cnt > keep)
+			inode->cmap_cnt = keep;
+		lock_release (&inode->cmap_lock);
+	}
+	inode->data.alloc_cnt = 0;
+	inode->tail = 0;
+	inode->dirty = true;
+}
+
+/* Jack */
+/* Writes zeros over bytes [FROM, TO) of INODE's data that lie in
+ * clusters already written; the others read as zeros anyway. Used when
+ * an extension exposes bytes past the old end of file, which may hold
+ * anything. INODE's lock must be held. */
+static void
+inode_zero_range (struct inode *inode, off_t from, off_t to) {
+	static char zeros[DISK_SECTOR_SIZE];
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	while (from < to) {
+		size_t idx = from / cluster_bytes ();
+		off_t cluster_end = (idx + 1) * cluster_bytes ();
+		off_t end = to < cluster_end? to: cluster_end;
+		cluster_t clst = inode_cluster (inode, idx);
+
+		for (off_t ofs = from; ofs < end && !fat_is_unwritten (clst); ) {
+			int sector_ofs = ofs % DISK_SECTOR_SIZE;
+			off_t chunk = DISK_SECTOR_SIZE - sector_ofs;
+			if (chunk > end - ofs)
+				chunk = end - ofs;
+			inode_data_write (&inode->data, cluster_to_sector (clst)
+					+ ofs % cluster_bytes () / DISK_SECTOR_SIZE,
+					zeros, sector_ofs, chunk);
+			ofs += chunk;
+		}
+		from = end;
+	}
+}
+
+/* Jack */
+/* Extends INODE to cover SIZE bytes at POS. INODE's lock must be
+ * held. */
+static bool
+extend_file (struct inode *inode, off_t pos, off_t size) {
+	off_t old_length = inode->data.length;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
 
 	if (pos + size <= inode->data.length)
 		return true;
-	
-	cluster_t need, last, curr;
-	for (curr = inode->data.start; curr != EOChain; curr = fat_get(curr))
-		last = curr;
-
-	if ((need = bytes_to_sectors(pos + size) - \
-		 bytes_to_sectors(inode->data.length > 0? inode->data.length: 1)) > 0) {
-		cluster_t new;
-
-		if (fat_create_multi_chain(last, need, &new)) {
-			size_t i;
-			cluster_t curr_cluster = new;
-			
-			static char zeros_extend[DISK_SECTOR_SIZE];
-			for (i = 0; i < need; i++)
-			{
-				ASSERT (curr_cluster != EOChain);
-				disk_write (filesys_disk, cluster_to_sector(curr_cluster), zeros_extend); 
-				curr_cluster = fat_get(curr_cluster);
-			}
+
+	/* Jack - an inline file stays inline while it fits, and moves to
+	 * clusters the first time it does not. */
+	if (inode_is_inline (&inode->data)) {
+		if (pos + size > INODE_INLINE_BYTES) {
+			if (!inode_uninline (inode, bytes_to_clusters (pos + size)))
+				return false;
+			inode_zero_range (inode, old_length, pos);
+			inode->data.length = pos + size;
+			inode_write_disk (inode);
 		} else {
-			return false;
+			inode->data.length = pos + size;
+			inode->dirty = true;
 		}
+		return true;
+	}
+	
+	size_t alloc_cnt = inode_alloc_cnt (&inode->data);
+	size_t new_cnt = bytes_to_clusters(pos + size);
+
+	/* Jack - clusters are allocated a window ahead of the end, as large
+	 * as the file so far up to PREALLOC_BYTES, so a writer appending in
+	 * small pieces seldom allocates. inode_trim() gives back what is
+	 * left over on the last close. */
+	if (new_cnt > alloc_cnt) {
+		size_t window = DIV_ROUND_UP (PREALLOC_BYTES, cluster_bytes ());
+		if (window > alloc_cnt)
+			window = alloc_cnt;
+
+		if (inode_grow (inode, &inode->data, alloc_cnt, new_cnt + window))
+			inode->data.alloc_cnt = new_cnt + window;
+		else if (inode_grow (inode, &inode->data, alloc_cnt, new_cnt))
+			inode->data.alloc_cnt = new_cnt;
+		else
+			return false;
+		/* The new clusters are recorded on disk right away. */
+		inode_zero_range (inode, old_length, pos);
+		inode->data.length = pos + size;
+		inode_write_disk (inode);
+		return true;
 	}
 
 	/* Jack */
@@ -124,20 +747,71 @@ check_and_extend_file (struct inode *inode, off_t pos, off_t size) {
 	// disk_write (filesys_disk, cluster_to_sector(last), bounce); 
 	// free(bounce);	
 
+	/* Jack - the bytes between the old end and POS may hold anything,
+	 * since sectors past the end are not zeroed; a new length alone
+	 * reaches the disk lazily */
+	inode_zero_range (inode, old_length, pos);
 	inode->data.length = pos + size;
-	disk_write (filesys_disk, cluster_to_sector(inode->cluster), &inode->data);
+	inode->dirty = true;
 
 	return true;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Jack */
+/* Extend file */
+static bool
+check_and_extend_file (struct inode *inode, off_t pos, off_t size) {
+	bool success;
+
+	ASSERT (inode != NULL);
+
+	/* The length only grows, so a write inside it needs no lock. */
+	if (pos + size <= inode->data.length)
+		return true;
+
+	journal_begin ();
+	lock_acquire (&inode->lock);
+	success = extend_file (inode, pos, size);
+	lock_release (&inode->lock);
+	journal_end ();
+	return success;
+}
+
+/* Table of inodes in memory, so that opening a single inode twice
+ * returns the same `struct inode'.  Jack - it is hashed by sector and
+ * also holds up to INODE_CACHE_SIZE closed inodes, least recently
+ * closed last on CLOSED_INODES, so reopening a hot file does not read
+ * its inode again.  INODE_TABLE_LOCK guards both and every open_cnt.
+ * It is not held across disk I/O: an inode being read in or freed
+ * stays in the table marked busy, and openers wait on INODE_READY
+ * until it is ready or gone. */
+static struct hash inode_table;
+static struct list closed_inodes;
+static size_t closed_cnt;
+static struct lock inode_table_lock;
+static struct condition inode_ready;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (inode_get_inumber (hash_entry (e, struct inode, elem)));
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return inode_get_inumber (hash_entry (a, struct inode, elem))
+		< inode_get_inumber (hash_entry (b, struct inode, elem));
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	if (!hash_init (&inode_table, inode_hash, inode_less, NULL))
+		PANIC ("inode table creation failed");
+	list_init (&closed_inodes);
+	closed_cnt = 0;
+	lock_init (&inode_table_lock);
+	cond_init (&inode_ready);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -160,23 +834,17 @@ inode_create (disk_sector_t sector, off_t length, enum file_type type) {
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
 		/* Jack */
-		cluster_t clusters = length > 0? bytes_to_sectors (length): 1;
+		cluster_t clusters = bytes_to_clusters (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
 		disk_inode->type = type;
-		if (fat_create_multi_chain(0, clusters, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			
-			static char zeros[DISK_SECTOR_SIZE];
-			size_t i;
-			cluster_t curr_cluster = disk_inode->start;
-			
-			for (i = 0; i < clusters; i++)
-			{
-				ASSERT (curr_cluster != EOChain);
-				disk_write (filesys_disk, cluster_to_sector(curr_cluster), zeros); 
-				curr_cluster = fat_get(curr_cluster);
-			}
+		disk_inode->layout = fat_layout ();
+		/* Jack - a file small enough starts out inline. */
+		if (length <= INODE_INLINE_BYTES)
+			disk_inode->flags = INODE_INLINE;
+		if (inode_is_inline (disk_inode)
+				|| inode_grow (NULL, disk_inode, 0, clusters)) {
+			buffer_cache_write_meta (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			success = true; 
 		}
 		free (disk_inode);		
@@ -201,13 +869,14 @@ inode_create (disk_sector_t sector, off_t length) {
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
 		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
+			buffer_cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			if (sectors > 0) {
 				static char zeros[DISK_SECTOR_SIZE];
 				size_t i;
 
 				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
+					buffer_cache_write (disk_inode->start + i, zeros,
+							0, DISK_SECTOR_SIZE);
 			}
 			success = true; 
 		}
@@ -217,39 +886,54 @@ inode_create (disk_sector_t sector, off_t length) {
 }
 #endif 
 
+/* Jack */
+/* Adds an opener to INODE, which must not be busy, taking it off
+ * CLOSED_INODES if it had none. INODE_TABLE_LOCK must be held. */
+static void
+inode_hold (struct inode *inode) {
+	ASSERT (lock_held_by_current_thread (&inode_table_lock));
+	ASSERT (!inode->busy);
+
+	if (inode->open_cnt++ == 0) {
+		list_remove (&inode->lru_elem);
+		closed_cnt--;
+	}
+}
+
 /* Reads an inode from SECTOR
  * and returns a `struct inode' that contains it.
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct hash_elem *e;
+	struct inode *inode, key;
 
-	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
+	/* Check whether this inode is already in memory. */
 #ifndef EFILESYS
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.sector = sector;
 #else
-		if (inode->cluster == sector_to_cluster(sector)) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.cluster = sector_to_cluster(sector);
 #endif
+	lock_acquire (&inode_table_lock);
+	while ((e = hash_find (&inode_table, &key.elem)) != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		if (!inode->busy) {
+			inode_hold (inode);
+			lock_release (&inode_table_lock);
+			return inode;
+		}
+		/* Jack - wait until it is read in or gone, then look again */
+		cond_wait (&inode_ready, &inode_table_lock);
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&inode_table_lock);
 		return NULL;
+	}
 
 	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
-
 	/* Jack */
 #ifndef EFILESYS	
 	inode->sector = sector;
@@ -257,22 +941,43 @@ inode_open (disk_sector_t sector) {
 	inode->cluster = sector_to_cluster(sector);
 #endif
 	inode->open_cnt = 1;
+	inode->busy = true;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
 	// lock_init(&inode->inode_lock);
-#ifndef EFILESYS
-	disk_read (filesys_disk, inode->sector, &inode->data);
-#else
-	disk_read (filesys_disk, cluster_to_sector(inode->cluster), &inode->data);
+#ifdef EFILESYS
+	page_cache_set_init (&inode->pages);
+	inode->cmap = NULL;
+	inode->cmap_cnt = 0;
+	lock_init (&inode->cmap_lock);
+	dir_index_init (&inode->dir_index);
+	inode->tail = 0;
+	inode->dirty = false;
+	lock_init (&inode->lock);
 #endif
+	hash_insert (&inode_table, &inode->elem);
+	lock_release (&inode_table_lock);
+
+	/* Jack - read it in with the table unlocked; others opening the
+	 * same sector meanwhile wait for it */
+	buffer_cache_read (inode_get_inumber (inode), &inode->data,
+			0, DISK_SECTOR_SIZE);
+
+	lock_acquire (&inode_table_lock);
+	inode->busy = false;
+	cond_broadcast (&inode_ready, &inode_table_lock);
+	lock_release (&inode_table_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&inode_table_lock);
 		inode->open_cnt++;
+		lock_release (&inode_table_lock);
+	}
 	return inode;
 }
 
@@ -287,35 +992,110 @@ inode_get_inumber (const struct inode *inode) {
 #endif
 }
 
+/* Jack */
+/* Returns the closed inode to free to make room: the least recently
+ * closed one, but passing over directories with a built name index,
+ * which would take a scan of the whole directory to rebuild, while
+ * there is anything else. INODE_TABLE_LOCK must be held. */
+static struct inode *
+inode_lru_victim (void) {
+	ASSERT (lock_held_by_current_thread (&inode_table_lock));
+	ASSERT (!list_empty (&closed_inodes));
+
+#ifdef EFILESYS
+	for (struct list_elem *e = list_rbegin (&closed_inodes);
+			e != list_rend (&closed_inodes); e = list_prev (e)) {
+		struct inode *inode = list_entry (e, struct inode, lru_elem);
+		if (!inode->dir_index.built)
+			return inode;
+	}
+#endif
+	return list_entry (list_back (&closed_inodes), struct inode, lru_elem);
+}
+
+/* Frees INODE, which no one has open, and its blocks if it was
+ * removed.  INODE must be marked busy, so that it cannot be opened
+ * again while its cached data is still being written back; it
+ * leaves the table only once that is done.  INODE_TABLE_LOCK must
+ * not be held. */
+static void
+inode_free (struct inode *inode) {
+	ASSERT (inode->open_cnt == 0 && inode->busy);
+
+#ifdef EFILESYS
+	/* Jack - cached data goes out while the clusters are still ours */
+	page_cache_set_destroy (&inode->pages, !inode->removed);
+	if (!inode->removed && inode->dirty)
+		inode_write_disk (inode);
+	inode_cmap_free (inode);
+	dir_index_destroy (&inode->dir_index);
+	if (inode->removed) {
+		fat_remove_chain (inode->cluster, 0);
+		inode_release_data (&inode->data);
+	}
+#else
+	/* Deallocate blocks if removed. */
+	if (inode->removed) {
+		free_map_release (inode->sector, 1);
+		free_map_release (inode->data.start,
+				bytes_to_sectors (inode->data.length)); 
+	}
+#endif
+	lock_acquire (&inode_table_lock);
+	hash_delete (&inode_table, &inode->elem);
+	cond_broadcast (&inode_ready, &inode_table_lock);
+	lock_release (&inode_table_lock);
+	free (inode); 
+}
+
 /* Closes INODE and writes it to disk.
  * If this was the last reference to INODE, frees its memory.
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	struct inode *victim = NULL;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
+	journal_begin (); // Jack - freeing or trimming INODE is one operation
+	lock_acquire (&inode_table_lock);
 	/* Release resources if this was the last opener. */
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-
+		/* Jack - a removed inode goes at once; any other is kept for
+		 * a while, and the least recently closed one makes room. */
+		if (inode->removed)
+			victim = inode;
+		else {
 #ifdef EFILESYS
-		if (inode->removed) {
-			fat_remove_chain (inode->cluster, 0);
-			fat_remove_chain (inode->data.start, 0);
-		}
-#else
-		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+			/* Jack - what was allocated ahead of the end goes back
+			 * now, with INODE busy so no one reopens it meanwhile */
+			if (inode_has_slack (inode)) {
+				inode->busy = true;
+				lock_release (&inode_table_lock);
+				lock_acquire (&inode->lock);
+				inode_trim (inode);
+				lock_release (&inode->lock);
+				lock_acquire (&inode_table_lock);
+				inode->busy = false;
+				cond_broadcast (&inode_ready, &inode_table_lock);
+			}
 #endif
-		free (inode); 
+			list_push_front (&closed_inodes, &inode->lru_elem);
+			if (++closed_cnt > INODE_CACHE_SIZE) {
+				closed_cnt--;
+				victim = inode_lru_victim ();
+				list_remove (&victim->lru_elem);
+			}
+		}
+		if (victim != NULL)
+			victim->busy = true;
 	}
+	lock_release (&inode_table_lock);
+	if (victim != NULL)
+		inode_free (victim);
+	journal_end ();
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -337,9 +1117,31 @@ inode_get_removed (struct inode *inode) {
  * than SIZE if an error occurs or end of file is reached. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
+#ifdef EFILESYS
+	/* Jack - regular file data is served from the page cache */
+	if (inode->data.type == F_ORD)
+		return page_cache_read (inode, buffer_, size, offset);
+#endif
+	return inode_read_direct (inode, buffer_, size, offset);
+}
+
+/* Jack */
+/* Like inode_read_at(), but bypasses the page cache. */
+off_t
+inode_read_direct (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
+
+#ifdef EFILESYS
+	/* Jack */
+	if (inode_is_inline (&inode->data)) {
+		bytes_read = inode_inline_io (inode, buffer_, size, offset, false);
+		if (bytes_read >= 0)
+			return bytes_read;
+		bytes_read = 0;
+	}
+#endif
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -355,27 +1157,21 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		/* Copy the chunk out of the cached sector. */
+#ifdef EFILESYS
+		/* Jack - a cluster that was never written reads as zeros */
+		if (fat_is_unwritten (inode_cluster (inode, offset / cluster_bytes ())))
+			memset (buffer + bytes_read, 0, chunk_size);
+		else
+#endif
+		buffer_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_read;
 }
@@ -388,13 +1184,36 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
-	const uint8_t *buffer = buffer_;
-	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
-
 	if (inode->deny_write_cnt || !check_and_extend_file(inode, offset, size)) // Jack
 		return 0;
 
+#ifdef EFILESYS
+	/* Jack */
+	if (inode->data.type == F_ORD)
+		return page_cache_write (inode, buffer_, size, offset);
+#endif
+	return inode_write_direct (inode, buffer_, size, offset);
+}
+
+/* Jack */
+/* Writes within INODE's current length, bypassing the page cache and
+ * the deny-write check. Used to write cached pages back. */
+off_t
+inode_write_direct (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+#ifdef EFILESYS
+	/* Jack */
+	if (inode_is_inline (&inode->data)) {
+		bytes_written = inode_inline_io (inode, (void *) buffer_, size,
+				offset, true);
+		if (bytes_written >= 0)
+			return bytes_written;
+		bytes_written = 0;
+	}
+#endif
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -410,34 +1229,30 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+#ifdef EFILESYS
+		/* Jack - the rest of this write in the same cluster counts as
+		 * covered, so only the sectors it leaves out are zeroed */
+		size_t idx = offset / cluster_bytes ();
+		off_t end = offset + (size < inode_left? size: inode_left);
+		off_t cluster_end = (idx + 1) * cluster_bytes ();
+		inode_claim_cluster (inode, idx, offset,
+				end < cluster_end? end: cluster_end);
+#endif
+		/* Copy the chunk into the cached sector.  The cache only
+		 * reads the sector in when the chunk does not cover it. */
+#ifdef EFILESYS
+		inode_data_write (&inode->data, sector_idx, buffer + bytes_written,
+				sector_ofs, chunk_size); // Jack
+#else
+		buffer_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
+#endif
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_written;
 }
@@ -461,6 +1276,139 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+#ifdef EFILESYS
+/* Jack */
+/* Returns the page cache of INODE. */
+struct page_cache_set *
+inode_page_cache (struct inode *inode) {
+	return &inode->pages;
+}
+
+/* Jack */
+/* Starts reading SIZE bytes of INODE at OFS into the page cache in
+ * the background, if INODE's data is cached there. */
+void
+inode_read_ahead (struct inode *inode, off_t ofs, off_t size) {
+	if (inode->data.type == F_ORD && !inode_is_inline (&inode->data))
+		page_cache_read_ahead (inode, ofs, size);
+}
+
+/* Jack */
+/* Returns the name index of directory INODE. */
+struct dir_index *
+inode_dir_index (struct inode *inode) {
+	return &inode->dir_index;
+}
+#endif
+
+#ifdef EFILESYS
+/* Jack */
+/* Holds every inode in memory open and returns them, storing how many
+ * in *CNT, so that they can be written back without INODE_TABLE_LOCK.
+ * Closed ones come least recently closed first, so closing them again
+ * keeps their order. Inodes that are busy are left alone. Returns
+ * NULL if memory is short. */
+static struct inode **
+inode_hold_all (size_t *cnt) {
+	struct hash_iterator i;
+	struct inode **inodes;
+
+	*cnt = 0;
+	lock_acquire (&inode_table_lock);
+	inodes = malloc (hash_size (&inode_table) * sizeof *inodes);
+	if (inodes == NULL) {
+		lock_release (&inode_table_lock);
+		return NULL;
+	}
+	hash_first (&i, &inode_table);
+	while (hash_next (&i)) {
+		struct inode *inode = hash_entry (hash_cur (&i), struct inode, elem);
+		if (inode->open_cnt > 0 && !inode->busy) {
+			inode_hold (inode);
+			inodes[(*cnt)++] = inode;
+		}
+	}
+	while (!list_empty (&closed_inodes)) {
+		struct inode *inode = list_entry (list_back (&closed_inodes),
+				struct inode, lru_elem);
+		inode_hold (inode);
+		inodes[(*cnt)++] = inode;
+	}
+	lock_release (&inode_table_lock);
+	return inodes;
+}
+#endif
+
+/* Jack */
+/* Writes back the cached data of every inode in memory, and the
+ * inodes themselves if they changed. Inodes still open give back
+ * what was allocated past their end, as on their last close. */
+void
+inode_done (void) {
+#ifdef EFILESYS
+	size_t cnt;
+	struct inode **inodes = inode_hold_all (&cnt);
+
+	if (inodes == NULL)
+		return;
+	for (size_t k = 0; k < cnt; k++) {
+		struct inode *inode = inodes[k];
+
+		page_cache_set_flush (&inode->pages);
+		journal_begin ();
+		lock_acquire (&inode->lock);
+		inode_trim (inode);
+		if (inode->dirty)
+			inode_write_disk (inode);
+		lock_release (&inode->lock);
+		journal_end ();
+		inode_close (inode);
+	}
+	free (inodes);
+#endif
+}
+
+/* Jack */
+/* Writes back the cached data of every inode in memory, holding each
+ * open meanwhile instead of keeping INODE_TABLE_LOCK across the
+ * writes. */
+void
+inode_flush_all (void) {
+#ifdef EFILESYS
+	size_t cnt;
+	struct inode **inodes = inode_hold_all (&cnt);
+
+	if (inodes == NULL)
+		return;
+	for (size_t k = 0; k < cnt; k++) {
+		page_cache_set_flush (&inodes[k]->pages);
+		inode_close (inodes[k]);
+	}
+	free (inodes);
+#endif
+}
+
+/* Jack */
+/* Writes INODE's cached data and, if it changed, INODE itself to
+ * disk, along with everything else waiting in the buffer cache and
+ * the journal. */
+void
+inode_sync (struct inode *inode) {
+#ifdef EFILESYS
+	page_cache_set_flush (&inode->pages);
+	lock_acquire (&inode->lock);
+	if (inode->dirty)
+		inode_write_disk (inode);
+	lock_release (&inode->lock);
+	fat_flush ();
+#endif
+	buffer_cache_flush ();
+#ifdef EFILESYS
+	/* The data is on disk before the metadata that points at it. */
+	journal_commit ();
+#endif
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
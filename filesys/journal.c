@@ -0,0 +1,727 @@
+/* journal.c: Write-ahead journal of file system metadata. */
+
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/buffer_cache.h"
+#include "filesys/fat.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#ifdef EFILESYS
+/* Metadata sectors -- the FAT, inodes, directories and extent blocks --
+ * are written with buffer_cache_write_meta(), which gives a copy of
+ * the whole new sector to the running transaction instead of marking
+ * the cached sector dirty.  Every JOURNAL_INTERVAL, journald closes
+ * the running transaction as soon as no operation is half done and
+ * writes it to the log in one sequential run ended by a commit record,
+ * so a single commit covers every operation of the interval.  Later,
+ * journald checkpoints: it writes the committed sectors to their homes
+ * and starts the log over.  Mounting replays the transactions still
+ * in the log.
+ *
+ * An operation is what lies between journal_begin() and journal_end();
+ * it never spans two transactions.  Clusters an operation frees are
+ * not reused before its transaction is checkpointed, so the log never
+ * holds old metadata for a sector that has since become file data. */
+
+/* Ticks between two commits, and between two looks journald takes
+ * at whether an operation is waiting for one. */
+#define JOURNAL_INTERVAL (5 * TIMER_FREQ)
+#define JOURNAL_POLL (TIMER_FREQ / 20)
+
+/* Sectors kept in memory for transactions that are not checkpointed
+ * yet, past which the next operation waits for journald to commit
+ * and checkpoint first. */
+#define JOURNAL_PENDING_MAX 256
+
+/* Magic numbers of the records in the journal region. */
+#define JOURNAL_MAGIC 0x4a524e4c        /* Header, in its first sector. */
+#define JOURNAL_DESC_MAGIC 0x4a445343   /* Descriptor. */
+#define JOURNAL_COMMIT_MAGIC 0x4a434d54 /* Commit record. */
+
+/* Sectors listed in one descriptor. */
+#define JOURNAL_DESC_SECTORS 125
+
+/* First sector of the region.  The log starts at the next one with a
+ * record of transaction SEQ. */
+struct log_header {
+	uint32_t magic;
+	uint32_t seq;
+};
+
+/* Precedes CNT logged sectors of transaction SEQ, which belong at
+ * SECTORS. */
+struct log_desc {
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t cnt;
+	disk_sector_t sectors[JOURNAL_DESC_SECTORS];
+};
+
+/* Ends transaction SEQ, whose CNT logged sectors hash to CHECKSUM. */
+struct log_commit {
+	uint32_t magic;
+	uint32_t seq;
+	uint32_t cnt;
+	uint64_t checksum;
+};
+
+/* A sector of the journal region. */
+union log_record {
+	struct log_header header;
+	struct log_desc desc;
+	struct log_commit commit;
+	uint8_t raw[DISK_SECTOR_SIZE];
+};
+
+/* The newest copy of a sector in a transaction. */
+struct jblock {
+	disk_sector_t sector;           /* Home of DATA. */
+	uint32_t seq;                   /* Transaction it belongs to. */
+	bool stale;                     /* A newer copy bypassed the journal. */
+	struct hash_elem elem;          /* Element in transaction.blocks. */
+	uint8_t data[DISK_SECTOR_SIZE];
+};
+
+/* A transaction. */
+struct transaction {
+	uint32_t seq;                   /* Sequence number. */
+	struct hash blocks;             /* jblock by sector. */
+	size_t cnt;                     /* Number of BLOCKS. */
+	struct list_elem elem;          /* Element in committed. */
+};
+
+static bool active;                 /* Set between init and done. */
+static disk_sector_t log_start;     /* First sector of the region. */
+static size_t log_sectors;          /* Sectors in the region. */
+
+/* Guarded by JLOCK. */
+static struct transaction *running;     /* Takes new sectors. */
+static struct transaction *committing;  /* Being logged, or NULL. */
+static struct list committed;           /* Not yet checkpointed. */
+static size_t pending_cnt;          /* Blocks in all of the above. */
+static size_t op_cnt;               /* Operations in RUNNING. */
+static bool gate_closed;            /* No operation may start. */
+static struct condition gate_open;  /* GATE_CLOSED became false. */
+static struct condition ops_done;   /* OP_CNT became 0. */
+static struct lock jlock;
+
+/* Serializes commits and checkpoints, and guards LOG_POS. */
+static struct lock commit_lock;
+static size_t log_pos;              /* Next free sector of the log. */
+
+/* Guarded by JLOCK.  An operation that finds the journal too full
+ * sets FLUSH_WANTED and waits on FLUSH_DONE for journald, which bumps
+ * FLUSH_SEQ after every commit. */
+static bool flush_wanted;
+static unsigned flush_seq;
+static struct condition flush_done;
+static struct thread *journald_thread;
+
+static long long commit_cnt, logged_cnt, checkpoint_cnt;
+
+static void journald (void *aux UNUSED);
+
+static uint64_t
+jblock_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct jblock, elem)->sector);
+}
+
+static bool
+jblock_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct jblock, elem)->sector
+		< hash_entry (b, struct jblock, elem)->sector;
+}
+
+static void
+jblock_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct jblock, elem));
+}
+
+/* Returns a new, empty transaction SEQ, or NULL if memory is short. */
+static struct transaction *
+txn_create (uint32_t seq) {
+	struct transaction *txn = malloc (sizeof *txn);
+
+	if (txn == NULL)
+		return NULL;
+	if (!hash_init (&txn->blocks, jblock_hash, jblock_less, NULL)) {
+		free (txn);
+		return NULL;
+	}
+	txn->seq = seq;
+	txn->cnt = 0;
+	return txn;
+}
+
+static void
+txn_destroy (struct transaction *txn) {
+	hash_destroy (&txn->blocks, jblock_free);
+	free (txn);
+}
+
+/* Returns TXN's copy of SECTOR, or NULL. */
+static struct jblock *
+txn_find (struct transaction *txn, disk_sector_t sector) {
+	struct jblock key;
+	struct hash_elem *e;
+
+	key.sector = sector;
+	e = hash_find (&txn->blocks, &key.elem);
+	return e != NULL? hash_entry (e, struct jblock, elem): NULL;
+}
+
+/* Returns the newest copy of SECTOR in any transaction, or NULL.
+ * JLOCK must be held. */
+static struct jblock *
+journal_find (disk_sector_t sector) {
+	struct jblock *b = txn_find (running, sector);
+	struct list_elem *e;
+
+	if (b == NULL && committing != NULL)
+		b = txn_find (committing, sector);
+	for (e = list_rbegin (&committed);
+			b == NULL && e != list_rend (&committed); e = list_prev (e))
+		b = txn_find (list_entry (e, struct transaction, elem), sector);
+	return b;
+}
+
+/* Marks every copy of SECTOR stale.  JLOCK must be held. */
+static void
+journal_forget (disk_sector_t sector) {
+	struct jblock *b;
+	struct list_elem *e;
+
+	if ((b = txn_find (running, sector)) != NULL)
+		b->stale = true;
+	if (committing != NULL && (b = txn_find (committing, sector)) != NULL)
+		b->stale = true;
+	for (e = list_begin (&committed); e != list_end (&committed);
+			e = list_next (e))
+		if ((b = txn_find (list_entry (e, struct transaction, elem),
+						sector)) != NULL)
+			b->stale = true;
+}
+
+/* Writes a header that starts the log over with transaction SEQ. */
+static void
+log_reset (uint32_t seq) {
+	static union log_record rec;
+
+	memset (&rec, 0, sizeof rec);
+	rec.header.magic = JOURNAL_MAGIC;
+	rec.header.seq = seq;
+	disk_write (filesys_disk, log_start, &rec);
+}
+
+/* Reads transaction SEQ from the log, starting at sector POS, and
+ * writes its sectors home through the buffer cache if REPLAY. Returns
+ * the sector after its commit record, or 0 if the log holds no whole
+ * transaction SEQ at POS. */
+static size_t
+log_scan (size_t pos, uint32_t seq, bool replay) {
+	static union log_record rec;
+	static uint8_t data[DISK_SECTOR_SIZE];
+	uint64_t checksum = 0;
+	size_t cnt = 0;
+
+	while (pos < log_sectors) {
+		disk_read (filesys_disk, log_start + pos++, &rec);
+		if (rec.desc.seq != seq)
+			break;
+		if (rec.commit.magic == JOURNAL_COMMIT_MAGIC)
+			return rec.commit.cnt == cnt && rec.commit.checksum == checksum?
+				pos: 0;
+		if (rec.desc.magic != JOURNAL_DESC_MAGIC
+				|| rec.desc.cnt > JOURNAL_DESC_SECTORS
+				|| pos + rec.desc.cnt > log_sectors)
+			break;
+		for (size_t k = 0; k < rec.desc.cnt; k++, cnt++) {
+			disk_read (filesys_disk, log_start + pos++, data);
+			checksum = checksum * 31 + hash_bytes (data, DISK_SECTOR_SIZE);
+			if (replay)
+				buffer_cache_write (rec.desc.sectors[k], data, 0,
+						DISK_SECTOR_SIZE);
+		}
+	}
+	return 0;
+}
+
+/* Writes home every transaction committed to the log before a crash.
+ * Returns the sequence number for the next transaction. */
+static uint32_t
+journal_recover (void) {
+	static union log_record rec;
+	size_t pos = 1, next, replayed = 0;
+	uint32_t seq;
+
+	disk_read (filesys_disk, log_start, &rec);
+	if (rec.header.magic != JOURNAL_MAGIC)
+		return 1;
+
+	seq = rec.header.seq;
+	while ((next = log_scan (pos, seq, false)) != 0) {
+		log_scan (pos, seq, true);
+		pos = next;
+		seq++;
+		replayed++;
+	}
+	if (replayed > 0) {
+		buffer_cache_flush ();
+		printf ("journal: replayed %zu transactions\n", replayed);
+	}
+	return seq;
+}
+
+/* Sets up the journal in the region the FAT boot sector reserves for
+ * it, replaying what it holds unless FORMAT, and starts journald. A
+ * file system without such a region is not journaled.  Must be called
+ * after fat_init() and before fat_open(). */
+void
+journal_init (bool format) {
+	uint32_t seq;
+
+	fat_journal_region (&log_start, &log_sectors);
+	if (log_sectors < JOURNAL_MIN_SECTORS)
+		return;
+
+	lock_init (&jlock);
+	lock_init (&commit_lock);
+	cond_init (&gate_open);
+	cond_init (&ops_done);
+	cond_init (&flush_done);
+	list_init (&committed);
+
+	seq = format? 1: journal_recover ();
+	if (format) {
+		/* Whatever an old file system left after the header must not
+		 * pass for a record of the new one. */
+		static uint8_t zeros[DISK_SECTOR_SIZE];
+		disk_write (filesys_disk, log_start + 1, zeros);
+	}
+	log_reset (seq);
+	log_pos = 1;
+
+	running = txn_create (seq);
+	if (running == NULL)
+		PANIC ("journal creation failed");
+	fat_hold_frees ();
+	active = true;
+
+	thread_create ("journald", PRI_DEFAULT, journald, NULL);
+}
+
+/* Waits until journald has committed and checkpointed, after the
+ * running thread asked for it. */
+static void
+journal_wait_flush (void) {
+	unsigned seq;
+
+	lock_acquire (&jlock);
+	seq = flush_seq;
+	flush_wanted = true;
+	/* A commit already under way when we asked does not count. */
+	while (flush_wanted || flush_seq == seq)
+		cond_wait (&flush_done, &jlock);
+	lock_release (&jlock);
+}
+
+/* Commits and checkpoints everything, and stops journaling.  Called on
+ * shutdown. */
+void
+journal_done (void) {
+	journal_flush ();
+	active = false;
+}
+
+/* Starts an operation: every metadata sector it writes goes into the
+ * same transaction.  Operations nest, and must be started before any
+ * file system lock is taken, since a commit may be waiting for
+ * operations in other threads to end.  If the journal holds too much,
+ * journald commits and checkpoints first; the commit is not made
+ * here, so that it always follows a flush of the file data. */
+void
+journal_begin (void) {
+	struct thread *t = thread_current ();
+
+	if (t->journal_depth == 0 && active && t != journald_thread
+			&& (pending_cnt >= JOURNAL_PENDING_MAX
+				|| fat_held_cnt () >= fat_cluster_cnt () / 8))
+		journal_wait_flush ();
+
+	if (t->journal_depth++ > 0 || !active)
+		return;
+	lock_acquire (&jlock);
+	while (gate_closed)
+		cond_wait (&gate_open, &jlock);
+	op_cnt++;
+	lock_release (&jlock);
+}
+
+/* Ends the operation started by the matching journal_begin(). */
+void
+journal_end (void) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t->journal_depth > 0);
+
+	if (--t->journal_depth > 0 || !active)
+		return;
+	lock_acquire (&jlock);
+	if (--op_cnt == 0)
+		cond_broadcast (&ops_done, &jlock);
+	lock_release (&jlock);
+}
+
+/* Ends the operations the running thread is in, so that a thread
+ * killed in the middle of one does not hold up every commit after. */
+void
+journal_abandon (void) {
+	while (thread_current ()->journal_depth > 0)
+		journal_end ();
+}
+
+/* Puts DATA, the new contents of metadata sector SECTOR, into the
+ * running transaction.  Returns false if the journal is not in use or
+ * memory is short; the caller then writes SECTOR in place. */
+bool
+journal_log (disk_sector_t sector, const void *data) {
+	struct jblock *b;
+
+	if (!active)
+		return false;
+
+	lock_acquire (&jlock);
+	b = txn_find (running, sector);
+	if (b == NULL && (b = malloc (sizeof *b)) != NULL) {
+		b->sector = sector;
+		b->seq = running->seq;
+		b->stale = false;
+		hash_insert (&running->blocks, &b->elem);
+		running->cnt++;
+		pending_cnt++;
+	}
+	if (b != NULL)
+		memcpy (b->data, data, DISK_SECTOR_SIZE);
+	else
+		/* The older copies must not end up on top of this one. */
+		journal_forget (sector);
+	lock_release (&jlock);
+	return b != NULL;
+}
+
+/* Copies the newest contents of SECTOR into DATA if they are in the
+ * journal and not yet at home.  Returns whether they were. */
+bool
+journal_read (disk_sector_t sector, void *data) {
+	struct jblock *b;
+	bool found;
+
+	if (!active)
+		return false;
+
+	lock_acquire (&jlock);
+	b = journal_find (sector);
+	found = b != NULL && !b->stale;
+	if (found)
+		memcpy (data, b->data, DISK_SECTOR_SIZE);
+	lock_release (&jlock);
+	return found;
+}
+
+/* Orders checkpointed blocks by home sector, newest first. */
+static int
+jblock_compare (const void *a_, const void *b_) {
+	const struct jblock *a = *(struct jblock * const *) a_;
+	const struct jblock *b = *(struct jblock * const *) b_;
+
+	if (a->sector != b->sector)
+		return a->sector < b->sector? -1: 1;
+	return a->seq > b->seq? -1: a->seq < b->seq;
+}
+
+/* Writes the sectors of every committed transaction home, then starts
+ * the log over with transaction NEXT_SEQ and lets the clusters those
+ * transactions freed be reused.  Each sector is written once, in
+ * sector order, if memory allows.  COMMIT_LOCK must be held. */
+static void
+checkpoint (uint32_t next_seq) {
+	struct list done;
+	struct jblock **blocks;
+	struct hash_iterator i;
+	struct list_elem *e;
+	size_t cnt = 0, freed = 0;
+
+	ASSERT (lock_held_by_current_thread (&commit_lock));
+
+	/* Commits need COMMIT_LOCK, so the list cannot change meanwhile. */
+	if (list_empty (&committed))
+		return;
+	for (e = list_begin (&committed); e != list_end (&committed);
+			e = list_next (e))
+		cnt += list_entry (e, struct transaction, elem)->cnt;
+
+	blocks = malloc (cnt * sizeof *blocks);
+	if (blocks != NULL) {
+		size_t n = 0;
+		for (e = list_begin (&committed); e != list_end (&committed);
+				e = list_next (e)) {
+			hash_first (&i, &list_entry (e, struct transaction, elem)->blocks);
+			while (hash_next (&i))
+				blocks[n++] = hash_entry (hash_cur (&i), struct jblock, elem);
+		}
+		qsort (blocks, cnt, sizeof *blocks, jblock_compare);
+		for (n = 0; n < cnt; n++)
+			if ((n == 0 || blocks[n]->sector != blocks[n - 1]->sector)
+					&& !blocks[n]->stale)
+				disk_write (filesys_disk, blocks[n]->sector, blocks[n]->data);
+		free (blocks);
+	} else
+		for (e = list_begin (&committed); e != list_end (&committed);
+				e = list_next (e)) {
+			hash_first (&i, &list_entry (e, struct transaction, elem)->blocks);
+			while (hash_next (&i)) {
+				struct jblock *b = hash_entry (hash_cur (&i), struct jblock,
+						elem);
+				if (!b->stale)
+					disk_write (filesys_disk, b->sector, b->data);
+			}
+		}
+
+	log_reset (next_seq);
+	log_pos = 1;
+	fat_release_frees ();
+	checkpoint_cnt++;
+
+	list_init (&done);
+	lock_acquire (&jlock);
+	while (!list_empty (&committed)) {
+		e = list_pop_front (&committed);
+		freed += list_entry (e, struct transaction, elem)->cnt;
+		list_push_back (&done, e);
+	}
+	pending_cnt -= freed;
+	lock_release (&jlock);
+	while (!list_empty (&done))
+		txn_destroy (list_entry (list_pop_front (&done), struct transaction,
+				elem));
+}
+
+/* Sectors of log that TXN takes. */
+static size_t
+txn_log_sectors (const struct transaction *txn) {
+	return DIV_ROUND_UP (txn->cnt, JOURNAL_DESC_SECTORS) + txn->cnt + 1;
+}
+
+/* Appends TXN to the log: its sectors behind descriptors, then the
+ * commit record.  COMMIT_LOCK must be held and the log must have
+ * room. */
+static void
+txn_write_log (struct transaction *txn) {
+	static union log_record rec;
+	struct hash_iterator i, j;
+	uint64_t checksum = 0;
+
+	ASSERT (log_pos + txn_log_sectors (txn) <= log_sectors);
+
+	/* I lists the sectors in each descriptor, J then writes them; no
+	 * one changes TXN, so both see the same order. */
+	hash_first (&i, &txn->blocks);
+	hash_first (&j, &txn->blocks);
+	for (size_t left = txn->cnt; left > 0;) {
+		size_t cnt = left < JOURNAL_DESC_SECTORS? left: JOURNAL_DESC_SECTORS;
+
+		memset (&rec, 0, sizeof rec);
+		rec.desc.magic = JOURNAL_DESC_MAGIC;
+		rec.desc.seq = txn->seq;
+		rec.desc.cnt = cnt;
+		for (size_t k = 0; k < cnt && hash_next (&i); k++)
+			rec.desc.sectors[k] = hash_entry (hash_cur (&i), struct jblock,
+					elem)->sector;
+		disk_write (filesys_disk, log_start + log_pos++, &rec);
+
+		for (size_t k = 0; k < cnt && hash_next (&j); k++) {
+			struct jblock *b = hash_entry (hash_cur (&j), struct jblock, elem);
+			disk_write (filesys_disk, log_start + log_pos++, b->data);
+			checksum = checksum * 31 + hash_bytes (b->data, DISK_SECTOR_SIZE);
+		}
+		left -= cnt;
+	}
+
+	memset (&rec, 0, sizeof rec);
+	rec.commit.magic = JOURNAL_COMMIT_MAGIC;
+	rec.commit.seq = txn->seq;
+	rec.commit.cnt = txn->cnt;
+	rec.commit.checksum = checksum;
+	disk_write (filesys_disk, log_start + log_pos++, &rec);
+	logged_cnt += txn->cnt;
+}
+
+/* Commits the running transaction: waits for the operations in it to
+ * end, closes it and writes it to the log.  The running thread must
+ * not be in an operation. */
+void
+journal_commit (void) {
+	struct transaction *txn, *next;
+	bool fits = true;
+
+	if (!active)
+		return;
+	ASSERT (thread_current ()->journal_depth == 0);
+
+	lock_acquire (&commit_lock);
+	next = txn_create (running->seq + 1);
+	if (next == NULL) {
+		lock_release (&commit_lock);
+		return;
+	}
+
+	lock_acquire (&jlock);
+	gate_closed = true;
+	while (op_cnt > 0)
+		cond_wait (&ops_done, &jlock);
+	lock_release (&jlock);
+
+	/* The FAT only goes into the log here, where it agrees with the
+	 * rest of the transaction. */
+	fat_flush ();
+
+	lock_acquire (&jlock);
+	txn = running;
+	if (txn->cnt > 0) {
+		running = next;
+		committing = txn;
+		next = NULL;
+	}
+	lock_release (&jlock);
+
+	if (next == NULL) {
+		/* A transaction that does not fit in the log behind the others
+		 * waits for a checkpoint.  The gate stays closed meanwhile, so
+		 * that the clusters the FAT holds back for TXN are not let go
+		 * with the others. */
+		fits = txn_log_sectors (txn) < log_sectors;
+		if (fits && log_pos + txn_log_sectors (txn) > log_sectors)
+			checkpoint (txn->seq);
+		fat_commit_frees ();
+	}
+
+	lock_acquire (&jlock);
+	gate_closed = false;
+	cond_broadcast (&gate_open, &jlock);
+	lock_release (&jlock);
+
+	if (next != NULL) {
+		/* Nothing to commit. */
+		txn_destroy (next);
+		lock_release (&commit_lock);
+		return;
+	}
+
+	if (fits)
+		txn_write_log (txn);
+	lock_acquire (&jlock);
+	committing = NULL;
+	list_push_back (&committed, &txn->elem);
+	lock_release (&jlock);
+	commit_cnt++;
+
+	/* One that does not fit at all goes home without the log. */
+	if (!fits)
+		checkpoint (running->seq);
+	lock_release (&commit_lock);
+}
+
+/* Writes the file data in the page and buffer caches to disk, then
+ * commits the running transaction, so the FAT it commits never points
+ * at clusters whose data is not there yet.  Checkpoints afterwards if
+ * ALL, once the log is half full, or if nothing was committed.  The
+ * running thread must not be in an operation or hold a file system
+ * lock. */
+static void
+journal_sync (bool all) {
+	bool idle = running->cnt == 0;
+
+	inode_flush_all ();
+	buffer_cache_flush ();
+	journal_commit ();
+
+	lock_acquire (&commit_lock);
+	if (active && (all || idle || log_pos > log_sectors / 2
+				|| pending_cnt > JOURNAL_PENDING_MAX / 2))
+		checkpoint (running->seq);
+	lock_release (&commit_lock);
+}
+
+/* Writes back the file data, then commits and checkpoints everything,
+ * so the disk holds all of it at home. */
+void
+journal_flush (void) {
+	if (!active)
+		return;
+	journal_sync (true);
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void) {
+	printf ("Journal: %lld commits, %lld sectors logged, %lld checkpoints\n",
+			commit_cnt, logged_cnt, checkpoint_cnt);
+}
+
+/* Journal worker: commits the operations of each interval together,
+ * and checkpoints in the background once the log is half full or
+ * nothing was committed for an interval.  An operation that finds the
+ * journal too full gets its commit and checkpoint early.  As in
+ * inode_sync(), the file data goes to disk before the commit of the
+ * FAT that points at it, so a crash never leaves new clusters holding
+ * stale sectors. */
+static void
+journald (void *aux UNUSED) {
+	journald_thread = thread_current ();
+	for (;;) {
+		int64_t start = timer_ticks ();
+		bool wanted;
+
+		while (!flush_wanted && timer_elapsed (start) < JOURNAL_INTERVAL)
+			timer_sleep (JOURNAL_POLL);
+
+		lock_acquire (&jlock);
+		wanted = flush_wanted;
+		flush_wanted = false;
+		lock_release (&jlock);
+
+		journal_sync (wanted);
+
+		lock_acquire (&jlock);
+		flush_seq++;
+		cond_broadcast (&flush_done, &jlock);
+		lock_release (&jlock);
+	}
+}
+#else
+/* Only the FAT file system keeps a journal; the system calls that
+ * bracket operations with these work on the basic one too. */
+void
+journal_begin (void) {
+}
+
+void
+journal_end (void) {
+}
+
+void
+journal_abandon (void) {
+}
+#endif /* EFILESYS */
@@ -1,9 +1,17 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "filesys/inode.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+#ifdef EFILESYS
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
 static void page_cache_destroy (struct page *page);
+static void page_cache_read_aheadd (void *aux UNUSED);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations page_cache_op = {
@@ -13,38 +21,449 @@ static const struct page_operations page_cache_op = {
 	.type = VM_PAGE_CACHE,
 };
 
-tid_t page_cache_workerd;
+/* Jack */
+/* Most read-ahead requests waiting for the worker; more are dropped. */
+#define READ_AHEAD_QUEUE 16
+
+/* A range of a file to bring into the page cache ahead of its
+ * reader. */
+struct read_ahead {
+	struct list_elem elem;      /* Element in ra_queue. */
+	struct inode *inode;        /* Reopened for the request. */
+	off_t ofs;                  /* Page aligned start. */
+	off_t end;                  /* End, exclusive. */
+};
+
+static struct list ra_queue;
+static size_t ra_cnt;
+static struct lock ra_lock;         /* Guards the two above. */
+static struct condition ra_ready;   /* Signaled when a request comes. */
 
 /* The initializer of file vm */
+/* Jack - starts the read-ahead worker. Dirty pages are written back
+ * when they are evicted, when their inode is closed for the last time
+ * and on filesys_done(); periodic write-behind happens one level down,
+ * in the buffer cache. */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	list_init (&ra_queue);
+	ra_cnt = 0;
+	lock_init (&ra_lock);
+	cond_init (&ra_ready);
+	thread_create ("pc_readaheadd", PRI_DEFAULT, page_cache_read_aheadd,
+			NULL);
 }
 
 /* Initialize the page cache */
 bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
+page_cache_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &page_cache_op;
 
+	/* Jack */
+	struct page_cache *pc = &page->page_cache;
+	pc->inode = NULL;
+	pc->ofs = 0;
+	pc->dirty = false;
+	pc->accessed = false;
+	list_init (&pc->mappers);
+	return true;
+}
+
+/* Jack */
+/* Number of bytes of INODE's data in the page at OFS. */
+static off_t
+page_bytes (struct inode *inode, off_t ofs) {
+	off_t length = inode_length (inode);
+
+	if (ofs >= length)
+		return 0;
+	return length - ofs < PGSIZE? length - ofs: PGSIZE;
 }
 
 /* Utilze the Swap in mechanism to implement readhead */
+/* Jack - fills the page from disk; bytes past the end of file read
+ * as zeros, which is also what a mapping of the last page shows. */
 static bool
 page_cache_readahead (struct page *page, void *kva) {
+	struct page_cache *pc = &page->page_cache;
+	off_t read_bytes = page_bytes (pc->inode, pc->ofs);
+
+	if (inode_read_direct (pc->inode, kva, read_bytes, pc->ofs) != read_bytes)
+		return false;
+	memset (kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+/* Jack */
+/* Writes PAGE's data in KVA back to its file if it is dirty. The
+ * flag is cleared first, so a write that lands during the write-back
+ * marks the page dirty again. Only the part within the file is
+ * written: a mapping cannot extend a file. */
+static void
+page_cache_write_out (struct page *page, void *kva) {
+	struct page_cache *pc = &page->page_cache;
+
+	if (!pc->dirty)
+		return;
+	pc->dirty = false;
+	inode_write_direct (pc->inode, kva, page_bytes (pc->inode, pc->ofs),
+			pc->ofs);
 }
 
 /* Utilze the Swap out mechanism to implement writeback */
+/* Jack - called by the evictor after page_cache_unmap_all(). */
 static bool
 page_cache_writeback (struct page *page) {
+	page_cache_write_out (page, page->frame->kva);
+	return true;
 }
 
 /* Destory the page_cache. */
 static void
 page_cache_destroy (struct page *page) {
+	ASSERT (list_empty (&page->page_cache.mappers));
+	vm_release_frame (page);
+}
+
+/* Jack */
+/* Hash function and comparator for a page_cache_set. */
+static uint64_t
+page_cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *page = hash_entry (e, struct page, hash_elem);
+	return hash_int (page->page_cache.ofs);
+}
+
+static bool
+page_cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page *a = hash_entry (a_, struct page, hash_elem);
+	const struct page *b = hash_entry (b_, struct page, hash_elem);
+	return a->page_cache.ofs < b->page_cache.ofs;
 }
 
-/* Worker thread for page cache */
+/* Jack */
+/* Initializes SET, the page cache of one inode. */
+void
+page_cache_set_init (struct page_cache_set *set) {
+	hash_init (&set->pages, page_cache_hash, page_cache_less, NULL);
+	lock_init (&set->lock);
+}
+
+/* Jack */
+/* Writes back PAGE if it is resident and dirty. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_sync (struct page *page) {
+	struct frame *frame = vm_pin_page (page);
+
+	if (frame != NULL) {
+		page_cache_write_out (page, frame->kva);
+		vm_unpin_frame (frame);
+	}
+}
+
+/* Jack */
+/* Writes back every dirty page in SET. */
+void
+page_cache_set_flush (struct page_cache_set *set) {
+	struct hash_iterator i;
+
+	lock_acquire (&set->lock);
+	hash_first (&i, &set->pages);
+	while (hash_next (&i))
+		page_cache_sync (hash_entry (hash_cur (&i), struct page, hash_elem));
+	lock_release (&set->lock);
+}
+
+static void
+page_cache_free (struct hash_elem *e, void *aux) {
+	struct page *page = hash_entry (e, struct page, hash_elem);
+	bool *writeback = aux;
+
+	if (*writeback)
+		page_cache_sync (page);
+	vm_dealloc_page (page);
+}
+
+/* Jack */
+/* Frees every page in SET, writing the dirty ones back first if
+ * WRITEBACK. Called on the last close of the inode, when no one can
+ * be reading, writing or mapping it any more. */
+void
+page_cache_set_destroy (struct page_cache_set *set, bool writeback) {
+	set->pages.aux = &writeback;
+	hash_destroy (&set->pages, page_cache_free);
+}
+
+/* Jack */
+/* Returns the frame that holds INODE's page at page aligned OFS,
+ * reading it in on a miss. The frame is returned pinned; release it
+ * with vm_unpin_frame(). Returns NULL if memory runs out. */
+static struct frame *
+page_cache_get (struct inode *inode, off_t ofs) {
+	struct page_cache_set *set = inode_page_cache (inode);
+	struct page key, *page;
+	struct hash_elem *e;
+	struct frame *frame;
+
+	ASSERT (pg_ofs (ofs) == 0);
+
+	lock_acquire (&set->lock);
+	key.page_cache.ofs = ofs;
+	e = hash_find (&set->pages, &key.hash_elem);
+	if (e != NULL)
+		page = hash_entry (e, struct page, hash_elem);
+	else {
+		page = malloc (sizeof *page);
+		if (page == NULL) {
+			lock_release (&set->lock);
+			return NULL;
+		}
+		*page = (struct page) { .va = NULL, .frame = NULL, .pml4 = NULL,
+			.writable = true };
+		page_cache_initializer (page, VM_PAGE_CACHE, NULL);
+		page->page_cache.inode = inode;
+		page->page_cache.ofs = ofs;
+		hash_insert (&set->pages, &page->hash_elem);
+	}
+
+	/* Filling under SET->lock keeps two readers of a missing page
+	 * from both loading it. */
+	frame = vm_pin_page (page);
+	if (frame == NULL)
+		frame = vm_load_page (page);
+	if (frame != NULL)
+		page->page_cache.accessed = true;
+	lock_release (&set->lock);
+	return frame;
+}
+
+/* Jack */
+/* Reads SIZE bytes from INODE into BUFFER, starting at OFFSET, through
+ * the page cache. Returns the number of bytes read. */
+off_t
+page_cache_read (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	while (size > 0) {
+		int page_ofs = pg_ofs (offset);
+
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+
+		/* Number of bytes to actually copy out of this page. */
+		int chunk_size = size < min_left ? size : min_left;
+		if (chunk_size <= 0)
+			break;
+
+		struct frame *frame = page_cache_get (inode, offset - page_ofs);
+		if (frame == NULL)
+			break;
+		memcpy (buffer + bytes_read, frame->kva + page_ofs, chunk_size);
+		vm_unpin_frame (frame);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	return bytes_read;
+}
+
+/* Jack */
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET, through
+ * the page cache. The caller has already extended INODE to cover the
+ * range. Returns the number of bytes written. */
+off_t
+page_cache_write (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	while (size > 0) {
+		int page_ofs = pg_ofs (offset);
+
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+
+		/* Number of bytes to actually write into this page. */
+		int chunk_size = size < min_left ? size : min_left;
+		if (chunk_size <= 0)
+			break;
+
+		struct frame *frame = page_cache_get (inode, offset - page_ofs);
+		if (frame == NULL)
+			break;
+		memcpy (frame->kva + page_ofs, buffer + bytes_written, chunk_size);
+		frame->page->page_cache.dirty = true;
+		vm_unpin_frame (frame);
+
+		/* Advance. */
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	return bytes_written;
+}
+
+/* Jack */
+/* Asks the read-ahead worker to bring the pages of INODE that hold
+ * SIZE bytes at OFS into the page cache. Returns at once; the request
+ * is dropped if the worker is too far behind. */
+void
+page_cache_read_ahead (struct inode *inode, off_t ofs, off_t size) {
+	struct read_ahead *ra;
+
+	if (size <= 0)
+		return;
+	ra = malloc (sizeof *ra);
+	if (ra == NULL)
+		return;
+	ra->ofs = ofs - pg_ofs (ofs);
+	ra->end = ofs + size;
+
+	lock_acquire (&ra_lock);
+	if (ra_cnt >= READ_AHEAD_QUEUE) {
+		lock_release (&ra_lock);
+		free (ra);
+		return;
+	}
+	ra->inode = inode_reopen (inode);
+	list_push_back (&ra_queue, &ra->elem);
+	ra_cnt++;
+	cond_signal (&ra_ready, &ra_lock);
+	lock_release (&ra_lock);
+}
+
+/* Read-ahead worker: fills the page cache for queued requests, so a
+ * sequential reader finds its next pages resident. */
+static void
+page_cache_read_aheadd (void *aux UNUSED) {
+	for (;;) {
+		struct read_ahead *ra;
+
+		lock_acquire (&ra_lock);
+		while (list_empty (&ra_queue))
+			cond_wait (&ra_ready, &ra_lock);
+		ra = list_entry (list_pop_front (&ra_queue), struct read_ahead, elem);
+		ra_cnt--;
+		lock_release (&ra_lock);
+
+		for (off_t ofs = ra->ofs;
+				ofs < ra->end && ofs < inode_length (ra->inode); ofs += PGSIZE) {
+			struct frame *frame = page_cache_get (ra->inode, ofs);
+			if (frame == NULL)
+				break;
+			vm_unpin_frame (frame);
+		}
+		inode_close (ra->inode);
+		free (ra);
+	}
+}
+
+/* Jack */
+/* Takes mapping page MAPPER off its page cache page, moving the dirty
+ * bit of the mapping over. ft.lock must be held. */
+static void
+page_cache_detach (struct page_cache *pc, struct page *mapper) {
+	if (pml4_is_dirty (mapper->pml4, mapper->va))
+		pc->dirty = true;
+	pml4_clear_page (mapper->pml4, mapper->va);
+	mapper->frame = NULL;
+}
+
+/* Jack */
+/* Maps file page PAGE onto the page cache frame holding its data. */
+bool
+page_cache_map (struct page *page) {
+	struct file_page *file_page = &page->file;
+	struct frame *frame;
+	bool success;
+
+	frame = page_cache_get (file_get_inode (file_page->m_file), file_page->ofs);
+	if (frame == NULL)
+		return false;
+
+	ft_acquire ();
+	list_push_back (&frame->page->page_cache.mappers, &file_page->map_elem);
+	page->frame = frame;
+	ft_release ();
+
+	success = pml4_set_page (page->pml4, page->va, frame->kva, page->writable);
+	if (!success)
+		page_cache_unmap (page);
+	vm_unpin_frame (frame);
+	return success;
+}
+
+/* Jack */
+/* Removes file page PAGE's mapping of the page cache, if any. */
+void
+page_cache_unmap (struct page *page) {
+	ft_acquire ();
+	if (page->frame != NULL) {
+		list_remove (&page->file.map_elem);
+		page_cache_detach (&page->frame->page->page_cache, page);
+	}
+	ft_release ();
+}
+
+/* Jack */
+/* Returns whether PAGE was used through read(), write() or any
+ * mapping since the last call, and clears that. */
+bool
+page_cache_test_accessed (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+	bool accessed = pc->accessed;
+	struct list_elem *e;
+
+	pc->accessed = false;
+	for (e = list_begin (&pc->mappers); e != list_end (&pc->mappers);
+			e = list_next (e)) {
+		struct page *mapper = list_entry (e, struct page, file.map_elem);
+		if (pml4_is_accessed (mapper->pml4, mapper->va)) {
+			pml4_set_accessed (mapper->pml4, mapper->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Jack */
+/* Returns whether PAGE must be written back before it is dropped. */
+bool
+page_cache_is_dirty (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+	struct list_elem *e;
+
+	if (pc->dirty)
+		return true;
+	for (e = list_begin (&pc->mappers); e != list_end (&pc->mappers);
+			e = list_next (e)) {
+		struct page *mapper = list_entry (e, struct page, file.map_elem);
+		if (pml4_is_dirty (mapper->pml4, mapper->va))
+			return true;
+	}
+	return false;
+}
+
+/* Jack */
+/* Unmaps PAGE from every process mapping it, ahead of eviction. The
+ * mappers fault it back in through the page cache. */
+void
+page_cache_unmap_all (struct page *page) {
+	struct page_cache *pc = &page->page_cache;
+
+	while (!list_empty (&pc->mappers)) {
+		struct list_elem *e = list_pop_front (&pc->mappers);
+		page_cache_detach (pc, list_entry (e, struct page, file.map_elem));
+	}
 }
+#endif /* EFILESYS */
@@ -0,0 +1,18 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Number of names held by the directory entry cache. */
+#define DCACHE_SIZE 256
+
+void dcache_init (void);
+bool dcache_lookup (disk_sector_t dir, const char *name, bool *found,
+		disk_sector_t *sectorp);
+void dcache_insert (disk_sector_t dir, const char *name, bool found,
+		disk_sector_t sector);
+void dcache_invalidate (disk_sector_t dir, const char *name);
+void dcache_purge_dir (disk_sector_t dir);
+
+#endif /* filesys/dcache.h */
@@ -3,7 +3,10 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <hash.h>
 #include "devices/disk.h"
+#include "filesys/off_t.h"
+#include "threads/synch.h"
 
 /* Maximum length of a file name component.
  * This is the traditional UNIX maximum length.
@@ -21,6 +24,22 @@ enum file_type {
 	F_LINK = 2,
 };
 
+#ifdef EFILESYS
+/* Jack */
+/* Index of one directory's entries by name, kept in memory with its
+ * inode while the directory is open.  LOCK also serializes changes to
+ * the directory's entries. */
+struct dir_index {
+	struct hash names;          /* dir_index_entry by name, if BUILT. */
+	bool built;                 /* NAMES covers every entry in use. */
+	off_t free_hint;            /* No free slot lies before this. */
+	struct lock lock;
+};
+
+void dir_index_init (struct dir_index *);
+void dir_index_destroy (struct dir_index *);
+#endif
+
 /* Opening and closing directories. */
 bool dir_create (disk_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
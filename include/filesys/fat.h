@@ -3,6 +3,7 @@
 
 #include "devices/disk.h"
 #include "filesys/file.h"
+#include "filesys/filesys.h"
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -16,9 +17,13 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 
 #define FAT_MAGIC 0xEB3C9000 /* MAGIC string to identify FAT disk */
 #define EOChain 0x0FFFFFFF   /* End of cluster chain */
+/* Jack - set in the FAT entry of every newly allocated cluster until
+ * inode.c first writes file data to it. Until then the cluster's file
+ * data reads as zeros without touching the disk. */
+#define FAT_UNWRITTEN 0x80000000
 
 /* Sectors of FAT information. */
-#define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
+#define SECTORS_PER_CLUSTER 1 /* Default number of sectors per cluster */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
 
@@ -26,13 +31,20 @@ void fat_init (void);
 void fat_open (void);
 void fat_close (void);
 void fat_create (void);
-void fat_close (void);
+void fat_flush (void);
+void fat_print_stats (void);
 
 cluster_t fat_create_chain (
     cluster_t clst /* Cluster # to stretch, 0: Create a new chain */
 );
+cluster_t fat_create_contig_chain (
+    cluster_t clst, /* Cluster # to stretch, 0: Create a new chain */
+    cluster_t cnt   /* # of contiguous clusters to add */
+);
+cluster_t fat_alloc_run (cluster_t hint, cluster_t cnt);
+void fat_free_run (cluster_t start, cluster_t cnt);
 bool fat_create_multi_chain (
-    cluster_t clst, cluster_t size, cluster_t *clstp
+    cluster_t clst, cluster_t size, cluster_t *clstp, cluster_t *tailp
 );
 
 void fat_remove_chain (
@@ -40,7 +52,17 @@ void fat_remove_chain (
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
 );
 cluster_t fat_get (cluster_t clst);
+bool fat_is_unwritten (cluster_t clst);
+void fat_set_written (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
+cluster_t fat_cluster_cnt (void);
+unsigned fat_cluster_sectors (void);
+enum fs_layout fat_layout (void);
+void fat_hold_frees (void);
+void fat_commit_frees (void);
+void fat_release_frees (void);
+cluster_t fat_held_cnt (void);
+void fat_journal_region (disk_sector_t *start, size_t *cnt);
 disk_sector_t cluster_to_sector (cluster_t clst);
 cluster_t sector_to_cluster (disk_sector_t sector);
 
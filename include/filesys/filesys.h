@@ -8,6 +8,19 @@
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
 
+#ifdef EFILESYS
+/* How files map their data to clusters. Jack */
+enum fs_layout {
+	FS_LAYOUT_FAT = 0,          /* Follow the FAT chain. */
+	FS_LAYOUT_EXTENT = 1,       /* Runs of clusters listed in the inode. */
+};
+
+/* -fl: Layout of files on a disk formatted with -f. */
+extern enum fs_layout format_layout;
+/* -cs: Sectors per cluster on a disk formatted with -f. */
+extern unsigned format_cluster_sectors;
+#endif
+
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
 
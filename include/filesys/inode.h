@@ -8,8 +8,15 @@
 #include "filesys/directory.h"
 
 struct bitmap;
+struct page_cache_set;
+
+#ifdef EFILESYS
+/* Bytes of data a file can keep in its inode sector. */
+#define INODE_INLINE_BYTES 480
+#endif
 
 void inode_init (void);
+void inode_done (void);
 #ifdef FILESYS
 bool inode_create (disk_sector_t, off_t, enum file_type);
 #else
@@ -22,12 +29,22 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_direct (struct inode *, void *, off_t size, off_t offset);
+off_t inode_write_direct (struct inode *, const void *, off_t size,
+		off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+void inode_sync (struct inode *);
+void inode_flush_all (void);
 off_t inode_length (const struct inode *);
 
 /*** Jack ***/
 enum file_type inode_get_type (const struct inode *inode);
 bool inode_get_removed (struct inode *inode);
+struct page_cache_set *inode_page_cache (struct inode *inode);
+#ifdef EFILESYS
+struct dir_index *inode_dir_index (struct inode *inode);
+void inode_read_ahead (struct inode *inode, off_t ofs, off_t size);
+#endif
 
 #endif /* filesys/inode.h */
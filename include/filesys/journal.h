@@ -0,0 +1,25 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Largest journal region given to a new file system, and the smallest
+ * one the journal is used with. */
+#define JOURNAL_SECTORS 256
+#define JOURNAL_MIN_SECTORS 8
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_abandon (void);
+
+bool journal_log (disk_sector_t, const void *);
+bool journal_read (disk_sector_t, void *);
+void journal_commit (void);
+void journal_flush (void);
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
@@ -1,12 +1,50 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
 #include "vm/vm.h"
+#include <hash.h>
+#include <list.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
 
 struct page;
+struct inode;
 enum vm_type;
 
-struct page_cache {};
+/* A page of regular file data held in a frame of the frame table, so
+ * it is reclaimed along with anonymous memory. Pages that map the file
+ * (VM_FILE) borrow the frame and are kept on MAPPERS; changes to
+ * MAPPERS are made under the frame table lock. */
+struct page_cache {
+	struct inode *inode;        /* File the data belongs to. */
+	off_t ofs;                  /* Page aligned offset in INODE. */
+	bool dirty;                 /* Written since last written back. */
+	bool accessed;              /* Used since the clock last passed. */
+	struct list mappers;        /* file_page.map_elem of mapping pages. */
+};
 
-void page_cache_init (void);
+/* The cached pages of one inode, keyed by offset. */
+struct page_cache_set {
+	struct hash pages;
+	struct lock lock;           /* Guards PAGES and page fills. */
+};
+
+void pagecache_init (void);
 bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+
+void page_cache_set_init (struct page_cache_set *);
+void page_cache_set_flush (struct page_cache_set *);
+void page_cache_set_destroy (struct page_cache_set *, bool writeback);
+
+off_t page_cache_read (struct inode *, void *, off_t size, off_t offset);
+off_t page_cache_write (struct inode *, const void *, off_t size,
+		off_t offset);
+void page_cache_read_ahead (struct inode *, off_t ofs, off_t size);
+
+bool page_cache_map (struct page *page);
+void page_cache_unmap (struct page *page);
+
+/* For the evictor; the frame table lock must be held. */
+bool page_cache_test_accessed (struct page *page);
+bool page_cache_is_dirty (struct page *page);
+void page_cache_unmap_all (struct page *page);
 #endif
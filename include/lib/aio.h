@@ -0,0 +1,52 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+#include <stdint.h>
+
+/* Asynchronous I/O rings, shared between a user program and the
+   kernel.  The program fills submission entries (SQEs) at SQ_TAIL and
+   hands them over with aio_enter(); kernel worker threads carry them
+   out and post completion entries (CQEs) at CQ_TAIL, which the program
+   may poll without a system call and consumes by advancing CQ_HEAD.
+   Indices only grow; an entry lives at index % AIO_RING_ENTRIES. */
+
+/* Entries in each ring. */
+#define AIO_RING_ENTRIES 64
+
+/* Operations. */
+enum aio_op {
+	AIO_READ,                   /* pread() of LEN bytes at OFFSET. */
+	AIO_WRITE,                  /* pwrite() of LEN bytes at OFFSET. */
+	AIO_FSYNC,                  /* Write FD's data and inode to disk. */
+	AIO_OPEN,                   /* open() the path at BUF; RES is the fd. */
+};
+
+/* A request. */
+struct aio_sqe {
+	uint32_t op;                /* An enum aio_op. */
+	int32_t fd;                 /* File, unless OP is AIO_OPEN. */
+	void *buf;                  /* Buffer, or path for AIO_OPEN. */
+	uint32_t len;               /* Bytes to transfer. */
+	int32_t offset;             /* File offset to transfer at. */
+	uint64_t user_data;         /* Copied to the completion. */
+};
+
+/* The result of a request. */
+struct aio_cqe {
+	uint64_t user_data;         /* USER_DATA of the request. */
+	int32_t res;                /* What the blocking call returns. */
+	uint32_t flags;             /* Zero. */
+};
+
+/* The rings.  Must be page aligned and stay mapped, since the kernel
+   keeps the page resident from aio_setup() until the process exits. */
+struct aio_ring {
+	volatile uint32_t sq_head;  /* Next SQE the kernel takes. */
+	volatile uint32_t sq_tail;  /* Next SQE the program fills. */
+	volatile uint32_t cq_head;  /* Next CQE the program reads. */
+	volatile uint32_t cq_tail;  /* Next CQE the kernel posts. */
+	struct aio_sqe sq[AIO_RING_ENTRIES];
+	struct aio_cqe cq[AIO_RING_ENTRIES];
+} __attribute__ ((aligned (4096)));
+
+#endif /* lib/aio.h */
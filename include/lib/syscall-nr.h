@@ -36,6 +36,25 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Process creation without copying. */
+	SYS_SPAWN,                  /* Start a new process from an executable. */
+	SYS_VFORK,                  /* Create a child sharing the address space. */
+
+	/* Positioned and vectored file I/O. */
+	SYS_PREAD,                  /* Read from a file at an offset. */
+	SYS_PWRITE,                 /* Write to a file at an offset. */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_COPY_FILE_RANGE,        /* Copy between files in the kernel. */
+
+	/* Asynchronous I/O. */
+	SYS_AIO_SETUP,              /* Register the rings of <aio.h>. */
+	SYS_AIO_ENTER,              /* Submit requests, wait for completions. */
 };
 
+/* Jack - pass as the fd of mmap() to get zero-filled anonymous
+   memory.  ADDR may then be NULL to let the kernel pick the address. */
+#define MAP_ANON -1
+
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include "../syscall-nr.h"
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +14,15 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* One buffer of a readv() or writev() request. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Its size in bytes. */
+};
+
+/* Most buffers in one readv() or writev(). */
+#define IOV_MAX 1024
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -38,6 +48,23 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+/* Process creation without copying the address space. */
+pid_t spawn (const char *file, const char *argv[]);
+pid_t vfork (void);
+
+/* File I/O at an offset, and into or out of several buffers. */
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+int sendfile (int out_fd, int in_fd, unsigned length);
+
+/* Asynchronous I/O through the rings of <aio.h>. */
+struct aio_ring;
+int aio_setup (struct aio_ring *ring);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
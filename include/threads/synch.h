@@ -39,6 +39,23 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock {
+	struct lock lock;           /* Guards the fields below. */
+	struct condition can_read;  /* Signaled when no writer is left. */
+	struct condition can_write; /* Signaled when the lock is free. */
+	unsigned readers;           /* Number of readers holding it. */
+	unsigned writers_waiting;   /* Number of writers waiting for it. */
+	struct thread *writer;      /* Writer holding it, or NULL. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -132,17 +132,26 @@ struct thread
 
 	/*** Deny Write on Executables ***/
 	struct file *running_file;
+
+	/* Jack */
+	struct thread *vfork_parent;	// owner of the borrowed address space
+	struct aio_ctx *aio;			// asynchronous I/O rings, see userprog/aio.c
 #endif 
 
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
 	uintptr_t if_rsp; // eleshock
+
+	/* Jack */
+	struct list anon_maps;		// anonymous mmap regions
+	void *anon_map_hint;		// lowest address given to hint-less anonymous mmap
 #endif
 
 #ifdef FILESYS
 	/* Jack */
 	struct dir *working_dir;
+	int journal_depth;			// nesting of journal_begin(), see filesys/journal.c
 #endif
 
 	/* Owned by thread.c. */
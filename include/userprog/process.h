@@ -5,6 +5,8 @@
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_vfork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (const char *name, char *cmd_line);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -1,6 +1,8 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stddef.h>
+
 void syscall_init (void);
 void check_address (void *vaddr); /*** team 8 ***/
 
@@ -8,4 +10,19 @@ void check_address (void *vaddr); /*** team 8 ***/
 int open(const char *file);
 void close (int fd);
 
+/* Jack */
+struct file;
+struct file *open_file (const char *file);
+struct file *get_ordinary_file (int fd);
+
+/* Jack */
+/* One buffer of a readv() or writev() request. */
+struct iovec {
+	void *iov_base;             /* Start of the buffer. */
+	size_t iov_len;             /* Its size in bytes. */
+};
+
+/* Most buffers in one readv() or writev(). */
+#define IOV_MAX 1024
+
 #endif /* userprog/syscall.h */
@@ -1,7 +1,9 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <list.h>
 #include "vm/vm.h"
 struct page;
+struct thread;
 enum vm_type;
 
 /* Jack */
@@ -10,7 +12,25 @@ struct anon_page {
     swap_slot_t swap_slot;
 };
 
+/* Hint-less anonymous mappings are placed top-down in this range,
+ * right below the stack guard. */
+#define ANON_MAP_TOP STACK_GUARD_BOTTOM
+#define ANON_MAP_BOTTOM ((uint8_t *) 0x10000000)
+
+/* One anonymous mapping of the current process. */
+struct anon_map {
+    void *addr;
+    size_t page_cnt;
+    struct list_elem elem;
+};
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_copy_valid (struct page *page);
+
+void *do_mmap_anon (void *addr, size_t length, bool writable);
+bool do_munmap_anon (void *addr);
+bool anon_map_copy (struct thread *dst, struct thread *src);
+void anon_map_kill (struct thread *t);
 
 #endif
@@ -14,10 +14,14 @@ struct file_page {		// swap in/out, destroy시 필요한 data 추가
 	
 	uint32_t *open_count;
 	uint32_t now_page;
+
+	/* Jack */
+	struct list_elem map_elem;	/* In the page cache page's mappers. */
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_backed_claim (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
@@ -12,5 +12,6 @@ typedef int swap_slot_t;
 
 void swapdisk_init(void);
 bool swapdisk_swap_in(swap_slot_t slot, void *_kva, bool copy);
-swap_slot_t swapdisk_swap_out(void *_kva);
+swap_slot_t swapdisk_swap_out(void *_kva, swap_slot_t slot);
 void swapdisk_free_swap_slot(swap_slot_t slot);
+bool swapdisk_can_retain(void);
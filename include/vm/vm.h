@@ -34,10 +34,40 @@ enum vm_type {
 	VM_FCOPY = (1 << 7), // for VM FILE COPY
 	VM_FINIT = (1 << 8), // for VM FILE INIT COPY
 
+	/* Jack */
+	VM_ANONMAP = (1 << 9), // for anonymous mmap region
+
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Jack */
+/* The stack may grow down to STACK_LIMIT. The STACK_GUARD_PAGES pages
+ * below it are never mapped, so an overflowing stack faults instead of
+ * running into a mapping. */
+#define STACK_MAX (1 << 20)
+#define STACK_LIMIT ((uint8_t *) USER_STACK - STACK_MAX)
+#define STACK_GUARD_PAGES 16
+#define STACK_GUARD_BOTTOM (STACK_LIMIT - STACK_GUARD_PAGES * PGSIZE)
+
+/* True if [ADDR, ADDR + LENGTH) touches the stack or its guard. */
+#define overlaps_stack(addr, length) \
+	((uint8_t *) (addr) < (uint8_t *) USER_STACK \
+	 && (uint8_t *) (addr) + (length) > STACK_GUARD_BOTTOM)
+
+/* Pages added per stack growth fault (-sc) and stack pages claimed
+ * by each exec (-sp). */
+extern size_t stack_chunk_pages;
+extern size_t stack_prefault_pages;
+
+/* Jack */
+/* How vm_get_victim() picks a frame (-ev). */
+enum evict_policy {
+	EVICT_CLOCK,	/* Second chance only. */
+	EVICT_COST,		/* Second chance, preferring frames cheap to evict. */
+};
+extern enum evict_policy evict_policy;
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -90,6 +120,16 @@ struct segment {
 	uint32_t zero_bytes;
 };
 
+/* Jack */
+/* What a frame is being used for. Only unpinned FRAME_INUSE frames
+ * may be chosen for eviction. Changes are made under ft.lock. */
+enum frame_state {
+	FRAME_FREE,			/* Owned by a claimer, no page yet. */
+	FRAME_INUSE,		/* Holds a page whose contents are valid. */
+	FRAME_WRITEBACK,	/* Page contents are being written out. */
+	FRAME_READIN,		/* Page contents are being read in. */
+};
+
 /* The representation of "frame" */
 struct frame {
 	void *kva;
@@ -97,6 +137,8 @@ struct frame {
 
 	// Jack
 	struct list_elem f_elem;
+	enum frame_state state;
+	unsigned pin_cnt;			/* Pins held, see vm_pin_page(). */
 };
 
 /* Jack */
@@ -104,6 +146,7 @@ struct frame {
 struct frame_table {
 	struct list table;
 	struct lock lock;
+	struct condition io_done;	/* Signalled when a frame leaves I/O. */
 };
 
 /* The function table for page operations.
@@ -141,6 +184,7 @@ bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -155,6 +199,14 @@ enum vm_type page_get_type (struct page *page);
 void ft_init(void);
 void ft_insert(struct frame *fr);
 struct frame *ft_delete(struct frame *fr);
+void ft_acquire (void);
+void ft_release (void);
+struct frame *vm_load_page (struct page *page);
+void vm_wait_page_io (struct page *page);
+struct frame *vm_pin_page (struct page *page);
+struct frame *vm_pin_user_page (void *va);
+void vm_unpin_frame (struct frame *frame);
+void vm_release_frame (struct page *page);
 /* eleshock */
 void page_destructor (struct hash_elem *e, void *aux);
 
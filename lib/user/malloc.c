@@ -0,0 +1,301 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* User-space malloc(), modeled on the kernel's threads/malloc.c.
+
+   Each request is rounded up to a power of 2 and served by the
+   "descriptor" (size class) for blocks of that size.  The
+   descriptor keeps a list of free blocks.  When the list is empty
+   a new page, called an "arena", is obtained from the kernel with
+   an anonymous mmap() and divided into blocks of that size.
+
+   When every block of an arena is free again, the arena's blocks
+   are taken off the free list and the page is returned to the
+   kernel with munmap(), so the process's resident memory follows
+   the amount of live data instead of the high-water mark.  Each
+   descriptor keeps one empty arena back, though, so that a loop
+   allocating and freeing one block does not map and unmap a page
+   on every turn.
+
+   Blocks bigger than half a page do not fit a descriptor.  They
+   get their own anonymous mapping, with the page count stored in
+   the arena header, and are unmapped as soon as they are freed.
+
+   Pintos user processes are single threaded, so the descriptors
+   need no locking; fork() gives the child its own copy of the
+   whole allocator state along with the address space. */
+
+#define PAGE_SIZE 4096
+#define PAGE_MASK (PAGE_SIZE - 1)
+
+/* Free block, linked into its descriptor's free list. */
+struct block {
+	struct block *prev;
+	struct block *next;
+};
+
+/* Descriptor. */
+struct desc {
+	size_t block_size;          /* Size of each element in bytes. */
+	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	struct block free_list;     /* Sentinel of the free block list. */
+	struct arena *spare;        /* An empty arena kept back, or null. */
+};
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x9a548eed
+
+/* Arena. */
+struct arena {
+	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	struct desc *desc;          /* Owning descriptor, null for big block. */
+	size_t free_cnt;            /* Free blocks; pages in big block. */
+};
+
+/* Our set of descriptors. */
+static struct desc descs[10];   /* Descriptors. */
+static size_t desc_cnt;         /* Number of descriptors. */
+
+static struct arena *block_to_arena (struct block *);
+static struct block *arena_to_block (struct arena *, size_t idx);
+
+/* Free list helpers. */
+static inline bool
+free_list_empty (struct desc *d) {
+	return d->free_list.next == &d->free_list;
+}
+
+static inline void
+free_list_push (struct desc *d, struct block *b) {
+	b->prev = &d->free_list;
+	b->next = d->free_list.next;
+	d->free_list.next->prev = b;
+	d->free_list.next = b;
+}
+
+static inline void
+free_list_remove (struct block *b) {
+	b->prev->next = b->next;
+	b->next->prev = b->prev;
+}
+
+/* Initializes the descriptors on first use. */
+static void
+malloc_init (void) {
+	size_t block_size;
+
+	for (block_size = 16; block_size < PAGE_SIZE / 2; block_size *= 2) {
+		struct desc *d = &descs[desc_cnt++];
+		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+		d->block_size = block_size;
+		d->blocks_per_arena = (PAGE_SIZE - sizeof (struct arena)) / block_size;
+		d->free_list.prev = d->free_list.next = &d->free_list;
+		d->spare = NULL;
+	}
+}
+
+/* Maps PAGE_CNT fresh zeroed pages anywhere in the address space.
+   Returns a null pointer if the kernel refuses. */
+static void *
+pages_map (size_t page_cnt) {
+	return mmap (NULL, page_cnt * PAGE_SIZE, true, MAP_ANON, 0);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct desc *d;
+	struct block *b;
+	struct arena *a;
+
+	/* A null pointer satisfies a request for 0 bytes. */
+	if (size == 0)
+		return NULL;
+
+	if (desc_cnt == 0)
+		malloc_init ();
+
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			break;
+	if (d == descs + desc_cnt) {
+		/* SIZE is too big for any descriptor.
+		   Map enough pages to hold SIZE plus an arena. */
+		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PAGE_SIZE);
+		if (page_cnt < size / PAGE_SIZE)
+			return NULL;
+		a = pages_map (page_cnt);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize the arena to indicate a big block of PAGE_CNT
+		   pages, and return it. */
+		a->magic = ARENA_MAGIC;
+		a->desc = NULL;
+		a->free_cnt = page_cnt;
+		return a + 1;
+	}
+
+	/* If the free list is empty, create a new arena. */
+	if (free_list_empty (d)) {
+		size_t i;
+
+		a = pages_map (1);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = d->blocks_per_arena; i-- > 0; )
+			free_list_push (d, arena_to_block (a, i));
+	}
+
+	/* Get a block from free list and return it. */
+	b = d->free_list.next;
+	free_list_remove (b);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	if (a == d->spare)
+		d->spare = NULL;
+	return b;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (a != 0 && size / a != b)
+		return NULL;
+
+	/* Fresh mappings are already zeroed by the kernel, but recycled
+	   blocks are not. */
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+
+	return p;
+}
+
+/* Returns the number of bytes allocated for BLOCK. */
+static size_t
+block_size (void *block) {
+	struct block *b = block;
+	struct arena *a = block_to_arena (b);
+	struct desc *d = a->desc;
+
+	return d != NULL ? d->block_size
+		: PAGE_SIZE * a->free_cnt - ((uintptr_t) block & PAGE_MASK);
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	} else {
+		/* Growing or shrinking within the same block is free. */
+		if (old_block != NULL) {
+			size_t old_size = block_size (old_block);
+			if (new_size <= old_size && new_size > old_size / 2)
+				return old_block;
+		}
+
+		void *new_block = malloc (new_size);
+		if (old_block != NULL && new_block != NULL) {
+			size_t old_size = block_size (old_block);
+			size_t min_size = new_size < old_size ? new_size : old_size;
+			memcpy (new_block, old_block, min_size);
+			free (old_block);
+		}
+		return new_block;
+	}
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	if (p != NULL) {
+		struct block *b = p;
+		struct arena *a = block_to_arena (b);
+		struct desc *d = a->desc;
+
+		if (d != NULL) {
+			/* It's a normal block.  We handle it here. */
+
+#ifndef NDEBUG
+			/* Clear the block to help detect use-after-free bugs. */
+			memset (b, 0xcc, d->block_size);
+#endif
+
+			/* Add block to free list. */
+			free_list_push (d, b);
+
+			/* If the arena is now entirely unused, keep it as the
+			   spare if there is none, or else give the page back
+			   to the kernel. */
+			if (++a->free_cnt >= d->blocks_per_arena) {
+				size_t i;
+
+				ASSERT (a->free_cnt == d->blocks_per_arena);
+				if (d->spare == NULL) {
+					d->spare = a;
+					return;
+				}
+				for (i = 0; i < d->blocks_per_arena; i++)
+					free_list_remove (arena_to_block (a, i));
+				munmap (a);
+			}
+		} else {
+			/* It's a big block.  Unmap its pages. */
+			munmap (a);
+		}
+	}
+}
+
+/* Returns the arena that block B is inside. */
+static struct arena *
+block_to_arena (struct block *b) {
+	struct arena *a = (struct arena *) ((uintptr_t) b & ~(uintptr_t) PAGE_MASK);
+
+	/* Check that the arena is valid. */
+	ASSERT (a != NULL);
+	ASSERT (a->magic == ARENA_MAGIC);
+
+	/* Check that the block is properly aligned for the arena. */
+	ASSERT (a->desc == NULL
+			|| (((uintptr_t) b & PAGE_MASK) - sizeof *a) % a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || ((uintptr_t) b & PAGE_MASK) == sizeof *a);
+
+	return a;
+}
+
+/* Returns the (IDX - 1)'th block within arena A. */
+static struct block *
+arena_to_block (struct arena *a, size_t idx) {
+	ASSERT (a != NULL);
+	ASSERT (a->magic == ARENA_MAGIC);
+	ASSERT (idx < a->desc->blocks_per_arena);
+	return (struct block *) ((uint8_t *) a + sizeof *a + idx * a->desc->block_size);
+}
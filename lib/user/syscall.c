@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -194,3 +194,64 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+pid_t
+spawn (const char *file, const char *argv[]) {
+	return (pid_t) syscall2 (SYS_SPAWN, file, argv);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned size) {
+	return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, size);
+}
+
+/* copy_file_range() with the arguments in the usual sendfile()
+   order.  OUT_FD may be STDOUT_FILENO. */
+int
+sendfile (int out_fd, int in_fd, unsigned size) {
+	return copy_file_range (in_fd, out_fd, size);
+}
+
+int
+aio_setup (struct aio_ring *ring) {
+	return syscall1 (SYS_AIO_SETUP, ring);
+}
+
+int
+aio_enter (unsigned to_submit, unsigned min_complete) {
+	return syscall2 (SYS_AIO_ENTER, to_submit, min_complete);
+}
+
+/* The vfork child runs on the parent's stack, so by the time the
+   parent resumes, the child may have overwritten our return address.
+   Keep it in %rdx, which the kernel restores for both of them. */
+_Static_assert (SYS_VFORK == 26, "update the vfork stub below");
+__asm__ (
+		".globl vfork\n"
+		".type vfork, @function\n"
+		"vfork:\n"
+		"\tpopq %rdx\n"
+		"\tmovq $26, %rax\n"
+		"\tsyscall\n"
+		"\tpushq %rdx\n"
+		"\tret\n");
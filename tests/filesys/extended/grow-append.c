@@ -0,0 +1,21 @@
+/* Grows a file from 0 bytes to 98,304 bytes, 17 bytes at a time,
+   the way a log writer appends records. */
+
+#include "tests/filesys/seq-test.h"
+#include "tests/main.h"
+
+static char buf[98304];
+
+static size_t
+return_block_size (void) 
+{
+  return 17;
+}
+
+void
+test_main (void) 
+{
+  seq_test ("logfile",
+            buf, sizeof buf, 0,
+            return_block_size, NULL);
+}
@@ -0,0 +1,26 @@
+/* Copies "sample.txt" into a new file with copy_file_range(), in two
+   steps so the file positions must carry over, and checks the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int size = sizeof sample - 1;
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy", 0), "create \"copy\"");
+  CHECK ((out = open ("copy")) > 1, "open \"copy\"");
+  CHECK (copy_file_range (in, out, 100) == 100, "copy 100 bytes");
+  CHECK (copy_file_range (in, out, 4096) == size - 100,
+         "copy the remaining %d bytes", size - 100);
+  msg ("close \"copy\"");
+  close (out);
+  msg ("close \"sample.txt\"");
+  close (in);
+  check_file ("copy", sample, size);
+}
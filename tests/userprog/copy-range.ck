@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "copy"
+(copy-range) open "copy"
+(copy-range) copy 100 bytes
+(copy-range) copy the remaining 273 bytes
+(copy-range) close "copy"
+(copy-range) close "sample.txt"
+(copy-range) open "copy" for verification
+(copy-range) verified contents of "copy"
+(copy-range) close "copy"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Reads "sample.txt" back to front in pieces with pread(), then
+   checks that the file position was never moved. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample - 1];
+  size_t size = sizeof sample - 1;
+  size_t ofs;
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (ofs = size; ofs > 0; )
+    {
+      size_t chunk = ofs < 37 ? ofs : 37;
+      ofs -= chunk;
+      if (pread (handle, buf + ofs, chunk, ofs) != (int) chunk)
+        fail ("pread of %zu bytes at %zu failed", chunk, ofs);
+    }
+  compare_bytes (buf, sample, size, 0, "sample.txt");
+  if (tell (handle) != 0)
+    fail ("pread moved the file position to %u", tell (handle));
+  msg ("close \"sample.txt\"");
+  close (handle);
+}
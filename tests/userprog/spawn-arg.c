@@ -0,0 +1,17 @@
+/* Spawns a child process with arguments, without forking first,
+   and waits for it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"child-args", "childarg", NULL};
+  pid_t pid;
+
+  if ((pid = spawn ("child-args", argv)) == PID_ERROR)
+    fail ("spawn failed");
+  msg ("wait(spawn()) = %d", wait (pid));
+}
@@ -0,0 +1,27 @@
+/* Creates a child with vfork(), which borrows our address space
+   until it calls exec(), then waits for it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int value = 42;
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  if ((pid = vfork ()) == 0)
+    {
+      /* Runs in the parent's address space. */
+      value = 43;
+      exec ("child-args childarg");
+      exit (-2);
+    }
+  if (pid == PID_ERROR)
+    fail ("vfork failed");
+  if (value != 43)
+    fail ("child did not share the parent's memory");
+  msg ("wait(vfork()) = %d", wait (pid));
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vfork-exec) begin
+(args) begin
+(args) argc = 2
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'childarg'
+(args) argv[2] = null
+(args) end
+vfork-exec: exit(0)
+(vfork-exec) wait(vfork()) = 0
+(vfork-exec) end
+vfork-exec: exit(0)
+EOF
+pass;
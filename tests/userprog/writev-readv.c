@@ -0,0 +1,35 @@
+/* Writes a file from several buffers of odd sizes with writev(),
+   then reads it back into a differently split set of buffers with
+   readv() and checks the data. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char data[6000];
+static char back[6000];
+
+void
+test_main (void) 
+{
+  struct iovec out[] = {
+    { data, 1 }, { data + 1, 100 }, { data + 101, 4999 }, { data + 5100, 900 },
+  };
+  struct iovec in[] = {
+    { back, 3000 }, { back + 3000, 7 }, { back + 3007, 2993 },
+  };
+  int handle;
+  size_t i;
+
+  for (i = 0; i < sizeof data; i++)
+    data[i] = i * 7 + 3;
+
+  CHECK (create ("vec", 0), "create \"vec\"");
+  CHECK ((handle = open ("vec")) > 1, "open \"vec\"");
+  CHECK (writev (handle, out, 4) == (int) sizeof data, "writev \"vec\"");
+  seek (handle, 0);
+  CHECK (readv (handle, in, 3) == (int) sizeof back, "readv \"vec\"");
+  compare_bytes (back, data, sizeof data, 0, "vec");
+  msg ("close \"vec\"");
+  close (handle);
+}
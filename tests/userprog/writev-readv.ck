@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-readv) begin
+(writev-readv) create "vec"
+(writev-readv) open "vec"
+(writev-readv) writev "vec"
+(writev-readv) readv "vec"
+(writev-readv) close "vec"
+(writev-readv) end
+writev-readv: exit(0)
+EOF
+pass;
@@ -0,0 +1,98 @@
+/* Writes, syncs, reads back and opens files through the asynchronous
+   I/O rings, and checks what completes. */
+
+#include <aio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+#define PAGE_SIZE 4096
+
+static struct aio_ring ring;
+static char wbuf[2 * PAGE_SIZE];
+static char rbuf[2 * PAGE_SIZE];
+static char sbuf[sizeof sample];
+
+/* Queues a request tagged USER_DATA. */
+static void
+submit (enum aio_op op, int fd, void *buf, unsigned len, int offset,
+        int user_data)
+{
+  struct aio_sqe *sqe = &ring.sq[ring.sq_tail % AIO_RING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  asm volatile ("" : : : "memory");
+  ring.sq_tail++;
+}
+
+/* Hands the CNT queued requests over, waits for them and stores the
+   result of each in RES, by its USER_DATA. */
+static void
+run (int cnt, int res[])
+{
+  int i;
+
+  CHECK (aio_enter (cnt, cnt) == cnt, "submit %d request(s)", cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct aio_cqe *cqe;
+
+      if (ring.cq_head == ring.cq_tail)
+        fail ("only %d of %d requests completed", i, cnt);
+      cqe = &ring.cq[ring.cq_head % AIO_RING_ENTRIES];
+      res[cqe->user_data] = cqe->res;
+      ring.cq_head++;
+    }
+}
+
+void
+test_main (void)
+{
+  int res[6];
+  int fd, sample_fd;
+  size_t i;
+
+  CHECK (create ("aio", 0), "create \"aio\"");
+  CHECK ((fd = open ("aio")) > 1, "open \"aio\"");
+  CHECK (aio_setup (&ring) == 0, "set up the rings");
+
+  for (i = 0; i < sizeof wbuf; i++)
+    wbuf[i] = i % 251;
+  submit (AIO_WRITE, fd, wbuf, PAGE_SIZE, 0, 0);
+  submit (AIO_WRITE, fd, wbuf + PAGE_SIZE, PAGE_SIZE, PAGE_SIZE, 1);
+  run (2, res);
+  if (res[0] != PAGE_SIZE || res[1] != PAGE_SIZE)
+    fail ("writes returned %d and %d", res[0], res[1]);
+
+  submit (AIO_FSYNC, fd, NULL, 0, 0, 2);
+  run (1, res);
+  if (res[2] != 0)
+    fail ("fsync returned %d", res[2]);
+
+  submit (AIO_READ, fd, rbuf, sizeof rbuf, 0, 3);
+  submit (AIO_OPEN, -1, "sample.txt", 0, 0, 4);
+  run (2, res);
+  if (res[3] != (int) sizeof rbuf)
+    fail ("read returned %d", res[3]);
+  if (memcmp (rbuf, wbuf, sizeof rbuf))
+    fail ("read back different data");
+  CHECK ((sample_fd = res[4]) > 1, "open \"sample.txt\"");
+
+  submit (AIO_READ, sample_fd, sbuf, sizeof sample - 1, 0, 5);
+  run (1, res);
+  if (res[5] != (int) sizeof sample - 1)
+    fail ("read of \"sample.txt\" returned %d", res[5]);
+  if (strcmp (sbuf, sample))
+    fail ("read of \"sample.txt\" returned wrong data");
+
+  submit (AIO_READ, 1234, rbuf, sizeof rbuf, 0, 5);
+  run (1, res);
+  CHECK (res[5] == -1, "read from a bad fd fails");
+}
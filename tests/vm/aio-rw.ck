@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(aio-rw) begin
+(aio-rw) create "aio"
+(aio-rw) open "aio"
+(aio-rw) set up the rings
+(aio-rw) submit 2 request(s)
+(aio-rw) submit 1 request(s)
+(aio-rw) submit 2 request(s)
+(aio-rw) open "sample.txt"
+(aio-rw) submit 1 request(s)
+(aio-rw) submit 1 request(s)
+(aio-rw) read from a bad fd fails
+(aio-rw) end
+EOF
+pass;
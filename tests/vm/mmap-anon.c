@@ -0,0 +1,62 @@
+/* Maps anonymous memory with and without an address hint, then
+   exercises the user-space malloc built on top of it. */
+
+#include <string.h>
+#include <syscall.h>
+#include <malloc.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BLOCK_CNT 64
+
+void
+test_main (void)
+{
+  char *fixed = (char *) 0x10000000;
+  char *any, *blocks[BLOCK_CNT], *big;
+  size_t i, j;
+
+  CHECK (mmap (fixed, 2 * PAGE_SIZE, 1, MAP_ANON, 0) == fixed,
+         "mmap anonymous memory at %p", fixed);
+  for (i = 0; i < 2 * PAGE_SIZE; i++)
+    if (fixed[i] != 0)
+      fail ("byte %zu of fixed mapping is not zero", i);
+  memset (fixed, 'a', 2 * PAGE_SIZE);
+
+  CHECK ((any = mmap (NULL, 3 * PAGE_SIZE, 1, MAP_ANON, 0)) != MAP_FAILED,
+         "mmap anonymous memory without a hint");
+  memset (any, 'b', 3 * PAGE_SIZE);
+  if (fixed[PAGE_SIZE] != 'a')
+    fail ("hint-less mapping overlapped the fixed one");
+  munmap (any);
+  munmap (fixed);
+
+  msg ("malloc and free");
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      blocks[i] = malloc (i * 37 + 1);
+      if (blocks[i] == NULL)
+        fail ("malloc #%zu failed", i);
+      memset (blocks[i], (int) i, i * 37 + 1);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < i * 37 + 1; j++)
+      if (blocks[i][j] != (char) i)
+        fail ("block %zu corrupted at byte %zu", i, j);
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    {
+      blocks[i] = realloc (blocks[i], i * 37 + 100);
+      if (blocks[i][i * 37] != (char) i)
+        fail ("realloc lost the contents of block %zu", i);
+      free (blocks[i]);
+    }
+
+  CHECK ((big = calloc (4, PAGE_SIZE)) != NULL, "calloc a multi-page block");
+  for (i = 0; i < 4 * PAGE_SIZE; i++)
+    if (big[i] != 0)
+      fail ("byte %zu of calloc'd block is not zero", i);
+  free (big);
+}
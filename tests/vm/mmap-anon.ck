@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous memory at 0x10000000
+(mmap-anon) mmap anonymous memory without a hint
+(mmap-anon) malloc and free
+(mmap-anon) calloc a multi-page block
+(mmap-anon) end
+EOF
+pass;
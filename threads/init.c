@@ -36,6 +36,9 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/fat.h"
+#include "filesys/journal.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -216,6 +219,17 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+#ifdef EFILESYS
+		else if (!strcmp (name, "-fl"))
+			format_layout = !strcmp (value, "extent") ? FS_LAYOUT_EXTENT
+				: FS_LAYOUT_FAT;
+		else if (!strcmp (name, "-cs")) {
+			int kb = value != NULL ? atoi (value) : 0;
+			if (kb < 4 || kb > 64 || (kb & (kb - 1)) != 0)
+				PANIC ("cluster size must be 4, 8, 16, 32 or 64 KiB");
+			format_cluster_sectors = kb * 1024 / DISK_SECTOR_SIZE;
+		}
+#endif
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -226,6 +240,14 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-sc"))
+			stack_chunk_pages = atoi (value) > 0 ? atoi (value) : 1;
+		else if (!strcmp (name, "-sp"))
+			stack_prefault_pages = atoi (value) > 0 ? atoi (value) : 1;
+		else if (!strcmp (name, "-ev"))
+			evict_policy = !strcmp (value, "clock") ? EVICT_CLOCK : EVICT_COST;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -324,10 +346,19 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef EFILESYS
+			"  -fl=LAYOUT         Format with `fat' (default) or `extent' files.\n"
+			"  -cs=KIB            Format with KIB KiB clusters (4 to 64).\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -sc=COUNT          Grow the user stack COUNT pages at a time.\n"
+			"  -sp=COUNT          Map COUNT stack pages when a process starts.\n"
+			"  -ev=POLICY         Evict by `clock' or by `cost' (default).\n"
 #endif
 			);
 	power_off ();
@@ -356,10 +387,18 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	buffer_cache_print_stats ();
+#ifdef EFILESYS
+	fat_print_stats ();
+	journal_print_stats ();
+#endif
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -359,6 +359,93 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 }
 
 
+/* Initializes readers-writer lock RW. Any number of readers may hold
+   RW at once, or a single writer. A waiting writer holds off readers
+   that arrive after it, so a steady stream of readers cannot starve
+   writers. Neither side is recursive. */
+void
+rwlock_init (struct rwlock *rw) {
+   ASSERT (rw != NULL);
+
+   lock_init (&rw->lock);
+   cond_init (&rw->can_read);
+   cond_init (&rw->can_write);
+   rw->readers = 0;
+   rw->writers_waiting = 0;
+   rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or waits
+   for it.  This function may sleep, so it must not be called within
+   an interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+   ASSERT (rw != NULL);
+   ASSERT (!intr_context ());
+   ASSERT (rw->writer != thread_current ());
+
+   lock_acquire (&rw->lock);
+   while (rw->writer != NULL || rw->writers_waiting > 0)
+      cond_wait (&rw->can_read, &rw->lock);
+   rw->readers++;
+   lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+   ASSERT (rw != NULL);
+
+   lock_acquire (&rw->lock);
+   ASSERT (rw->readers > 0);
+   if (--rw->readers == 0)
+      cond_signal (&rw->can_write, &rw->lock);
+   lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no reader or writer holds
+   it.  This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+   ASSERT (rw != NULL);
+   ASSERT (!intr_context ());
+   ASSERT (!rwlock_held_by_current_thread (rw));
+
+   lock_acquire (&rw->lock);
+   rw->writers_waiting++;
+   while (rw->writer != NULL || rw->readers > 0)
+      cond_wait (&rw->can_write, &rw->lock);
+   rw->writers_waiting--;
+   rw->writer = thread_current ();
+   lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. Another
+   waiting writer goes first; otherwise all waiting readers wake. */
+void
+rwlock_release_write (struct rwlock *rw) {
+   ASSERT (rw != NULL);
+   ASSERT (rwlock_held_by_current_thread (rw));
+
+   lock_acquire (&rw->lock);
+   rw->writer = NULL;
+   if (rw->writers_waiting > 0)
+      cond_signal (&rw->can_write, &rw->lock);
+   else
+      cond_broadcast (&rw->can_read, &rw->lock);
+   lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing.  Readers
+   are not tracked, so there is no reader counterpart. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) {
+   ASSERT (rw != NULL);
+
+   return rw->writer == thread_current ();
+}
+
 /*** GrilledSalmon ***/
 /* semaphore_elem의 elem을 가지고 semaphore를 구해서
  * semaphore의 waiters list를 가지고 begin elem을 구해서
@@ -630,6 +630,10 @@ init_thread(struct thread *t, const char *name, int priority)
     t->pml4 = NULL;
 	t->running_file = NULL;
 #endif
+#ifdef VM
+	list_init(&t->anon_maps);				/*** Jack ***/
+	t->anon_map_hint = NULL;
+#endif
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
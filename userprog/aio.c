@@ -0,0 +1,471 @@
+/* aio.c: Asynchronous I/O through rings shared with user programs. */
+
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "vm/vm.h"
+
+#ifdef VM
+/* Kernel threads carrying out requests. Requests wait in one queue
+ * however many rings there are, so the number of requests in flight
+ * does not depend on the number of threads. */
+#define AIO_WORKERS 4
+
+/* Most pages one read or write transfers; a longer one comes back
+ * short, as a pread() may. */
+#define AIO_MAX_PAGES 16
+
+/* The rings of one process. */
+struct aio_ctx {
+	struct aio_ring *ring;      /* Kernel address of the rings. */
+	struct frame *ring_frame;   /* Frame holding them, kept pinned. */
+	uint32_t sq_head;           /* Our copies of the indices we own, */
+	uint32_t cq_tail;           /* so the program cannot skew them. */
+	unsigned inflight;          /* Requests not finished yet. */
+	struct list opened;         /* Finished opens waiting for an fd. */
+	struct lock lock;           /* Guards the above and the CQ. */
+	struct condition done;      /* Signaled when a request finishes. */
+};
+
+/* A request handed to the workers. */
+struct aio_req {
+	struct aio_ctx *ctx;        /* Rings to post the completion to. */
+	uint32_t op;                /* An enum aio_op. */
+	uint64_t user_data;         /* From the SQE. */
+	struct file *file;          /* Own handle on the file, or the file
+	                               opened for AIO_OPEN. */
+	off_t offset;               /* File offset. */
+	size_t len;                 /* Bytes to transfer. */
+	size_t page_ofs;            /* Offset of the buffer in FRAMES[0]. */
+	struct frame *frames[AIO_MAX_PAGES];  /* Buffer, pinned. */
+	size_t frame_cnt;
+	char *path;                 /* Path for AIO_OPEN. */
+	struct dir *cwd;            /* Directory to resolve PATH from. */
+	int res;                    /* Result for the CQE. */
+	struct list_elem elem;      /* Element in queue or ctx->opened. */
+};
+
+static struct list queue;           /* Requests for the workers. */
+static struct lock queue_lock;      /* Guards QUEUE and WORKERS_STARTED. */
+static struct condition queue_ready;
+static bool workers_started;
+
+static void aio_workerd (void *aux UNUSED);
+
+/* Initializes the request queue. The workers start with the first
+ * ring, so a system without asynchronous I/O never runs them. */
+void
+aio_init (void) {
+	list_init (&queue);
+	lock_init (&queue_lock);
+	cond_init (&queue_ready);
+}
+
+/* Posts a completion of USER_DATA with RES.  CTX->lock must be held.
+ * The entry is written before the tail moves past it. */
+static void
+aio_post (struct aio_ctx *ctx, uint64_t user_data, int res) {
+	struct aio_cqe *cqe;
+
+	ASSERT (lock_held_by_current_thread (&ctx->lock));
+	cqe = &ctx->ring->cq[ctx->cq_tail % AIO_RING_ENTRIES];
+	cqe->user_data = user_data;
+	cqe->res = res;
+	cqe->flags = 0;
+	barrier ();
+	ctx->ring->cq_tail = ++ctx->cq_tail;
+}
+
+/* Returns the completions the program has not consumed yet.
+ * CTX->lock must be held. */
+static unsigned
+aio_unreaped (struct aio_ctx *ctx) {
+	uint32_t cnt = ctx->cq_tail - ctx->ring->cq_head;
+	return cnt < AIO_RING_ENTRIES? cnt: AIO_RING_ENTRIES;
+}
+
+/* Returns true if every request accepted so far is sure to find a
+ * free CQE.  CTX->lock must be held. */
+static bool
+aio_has_room (struct aio_ctx *ctx) {
+	return ctx->inflight + list_size (&ctx->opened) + aio_unreaped (ctx)
+		< AIO_RING_ENTRIES;
+}
+
+/* Gives the files opened for CTX their descriptors and posts their
+ * completions. Runs in the process, which owns its fd table.
+ * CTX->lock must be held. */
+static void
+aio_install_opened (struct aio_ctx *ctx) {
+	while (!list_empty (&ctx->opened)) {
+		struct aio_req *req = list_entry (list_pop_front (&ctx->opened),
+				struct aio_req, elem);
+		if (req->file != NULL) {
+			req->res = process_add_file (req->file);
+			if (req->res == -1)
+				file_close (req->file);
+		}
+		aio_post (ctx, req->user_data, req->res);
+		free (req);
+	}
+}
+
+/* Drops what REQ holds and frees it. */
+static void
+aio_req_free (struct aio_req *req) {
+	for (size_t i = 0; i < req->frame_cnt; i++)
+		vm_unpin_frame (req->frames[i]);
+	file_close (req->file);
+	dir_close (req->cwd);
+	if (req->path != NULL)
+		palloc_free_page (req->path);
+	free (req);
+}
+
+/* Reports REQ, which has been carried out, to its rings. An opened
+ * file waits on the ring's OPENED list for the process to give it a
+ * descriptor; any other request is done with. */
+static void
+aio_complete (struct aio_req *req) {
+	struct aio_ctx *ctx = req->ctx;
+	bool opened = req->op == AIO_OPEN;
+
+	for (size_t i = 0; i < req->frame_cnt; i++)
+		vm_unpin_frame (req->frames[i]);
+	req->frame_cnt = 0;
+
+	lock_acquire (&ctx->lock);
+	if (opened)
+		list_push_back (&ctx->opened, &req->elem);
+	else
+		aio_post (ctx, req->user_data, req->res);
+	ctx->inflight--;
+	cond_broadcast (&ctx->done, &ctx->lock);
+	lock_release (&ctx->lock);
+
+	if (!opened)
+		aio_req_free (req);
+}
+
+/* Pins the buffer of a read or write of SQE into REQ. Returns false
+ * if part of it is not mapped, or is read-only and would be written. */
+static bool
+aio_pin_buffer (struct aio_req *req, const struct aio_sqe *sqe) {
+	struct thread *curr = thread_current ();
+	uint8_t *buf = sqe->buf;
+	size_t len = sqe->len;
+
+	if (len > AIO_MAX_PAGES * PGSIZE - pg_ofs (buf))
+		len = AIO_MAX_PAGES * PGSIZE - pg_ofs (buf);
+	req->page_ofs = pg_ofs (buf);
+	req->len = len;
+	if (len == 0)
+		return true;
+	if (!is_user_vaddr (buf) || !is_user_vaddr (buf + len - 1))
+		return false;
+
+	for (uint8_t *va = pg_round_down (buf); va < buf + len; va += PGSIZE) {
+		if (sqe->op == AIO_READ) {
+			struct page *page = spt_find_page (&curr->spt, va);
+			if (page == NULL || !page->writable)
+				return false;
+		}
+		struct frame *frame = vm_pin_user_page (va);
+		if (frame == NULL)
+			return false;
+		req->frames[req->frame_cnt++] = frame;
+
+		/* The workers write through the kernel mapping, so record
+		 * the change where eviction and write-back look for it. */
+		if (sqe->op == AIO_READ)
+			pml4_set_dirty (curr->pml4, va, true);
+	}
+	return true;
+}
+
+/* Copies the string at user address UPATH into the page PATH, one
+ * byte at a time so that it stops at the first byte outside user
+ * memory. Returns false then, or if the string does not fit. */
+static bool
+aio_copy_path (char *path, const char *upath) {
+	for (size_t i = 0; i < PGSIZE; i++) {
+		if (!is_user_vaddr (upath + i))
+			return false;
+		if ((path[i] = upath[i]) == '\0')
+			return true;
+	}
+	return false;
+}
+
+/* Prepares SQE as a request. Runs in the submitting process, since
+ * the fd, the buffer and the path are all its own. Returns NULL if the
+ * request fails at once. */
+static struct aio_req *
+aio_prepare (struct aio_ctx *ctx, const struct aio_sqe *sqe) {
+	struct aio_req *req = calloc (1, sizeof *req);
+	struct file *file;
+
+	if (req == NULL)
+		return NULL;
+	req->ctx = ctx;
+	req->op = sqe->op;
+	req->user_data = sqe->user_data;
+
+	switch (sqe->op) {
+		case AIO_READ:
+		case AIO_WRITE:
+		case AIO_FSYNC:
+			/* A handle of our own, so closing FD does not pull the
+			 * file out from under the worker. */
+			file = get_ordinary_file (sqe->fd);
+			if (file == NULL || sqe->offset < 0
+					|| (req->file = file_reopen (file)) == NULL)
+				goto fail;
+			req->offset = sqe->offset;
+			if (sqe->op != AIO_FSYNC && !aio_pin_buffer (req, sqe))
+				goto fail;
+			break;
+
+		case AIO_OPEN:
+			if (sqe->buf == NULL || !is_user_vaddr (sqe->buf))
+				goto fail;
+			req->path = palloc_get_page (0);
+			if (req->path == NULL)
+				goto fail;
+			if (!aio_copy_path (req->path, sqe->buf))
+				goto fail;
+			req->cwd = dir_reopen (thread_current ()->working_dir);
+			break;
+
+		default:
+			goto fail;
+	}
+	return req;
+
+fail:
+	aio_req_free (req);
+	return NULL;
+}
+
+/* Carries out REQ and sets its result. */
+static void
+aio_do (struct aio_req *req) {
+	struct thread *curr = thread_current ();
+	size_t done = 0;
+
+	switch (req->op) {
+		case AIO_READ:
+		case AIO_WRITE:
+			for (size_t i = 0; i < req->frame_cnt && done < req->len; i++) {
+				size_t ofs = i == 0? req->page_ofs: 0;
+				size_t chunk = PGSIZE - ofs;
+				off_t moved;
+
+				if (chunk > req->len - done)
+					chunk = req->len - done;
+				if (req->op == AIO_READ)
+					moved = file_read_at (req->file, req->frames[i]->kva + ofs,
+							chunk, req->offset + done);
+				else
+					moved = file_write_at (req->file,
+							req->frames[i]->kva + ofs, chunk, req->offset + done);
+				done += moved;
+				if ((size_t) moved < chunk)
+					break;
+			}
+			req->res = done;
+			break;
+
+		case AIO_FSYNC:
+			inode_sync (file_get_inode (req->file));
+			req->res = 0;
+			break;
+
+		case AIO_OPEN:
+			/* Resolve the path the way the submitter would have. */
+			curr->working_dir = req->cwd;
+			req->file = open_file (req->path);
+			curr->working_dir = NULL;
+			req->res = req->file != NULL? 0: -1;
+
+			dir_close (req->cwd);
+			req->cwd = NULL;
+			palloc_free_page (req->path);
+			req->path = NULL;
+			break;
+	}
+}
+
+/* Worker: takes requests off the queue and carries them out. */
+static void
+aio_workerd (void *aux UNUSED) {
+	for (;;) {
+		struct aio_req *req;
+
+		lock_acquire (&queue_lock);
+		while (list_empty (&queue))
+			cond_wait (&queue_ready, &queue_lock);
+		req = list_entry (list_pop_front (&queue), struct aio_req, elem);
+		lock_release (&queue_lock);
+
+		aio_do (req);
+		aio_complete (req);
+	}
+}
+
+/* Registers RING, which must be page aligned and writable, as the
+ * current process's rings, and empties them. Returns 0 on success,
+ * -1 on failure. */
+int
+aio_setup (struct aio_ring *ring) {
+	struct thread *curr = thread_current ();
+	struct page *page;
+	struct aio_ctx *ctx;
+
+	if (curr->aio != NULL || ring == NULL || !is_user_vaddr (ring)
+			|| pg_ofs (ring) != 0)
+		return -1;
+	page = spt_find_page (&curr->spt, ring);
+	if (page == NULL || !page->writable)
+		return -1;
+
+	ctx = malloc (sizeof *ctx);
+	if (ctx == NULL)
+		return -1;
+	ctx->ring_frame = vm_pin_user_page (ring);
+	if (ctx->ring_frame == NULL) {
+		free (ctx);
+		return -1;
+	}
+	ctx->ring = ctx->ring_frame->kva;
+	ctx->ring->sq_head = ctx->ring->sq_tail = 0;
+	ctx->ring->cq_head = ctx->ring->cq_tail = 0;
+	ctx->sq_head = ctx->cq_tail = 0;
+	ctx->inflight = 0;
+	list_init (&ctx->opened);
+	lock_init (&ctx->lock);
+	cond_init (&ctx->done);
+
+	lock_acquire (&queue_lock);
+	if (!workers_started) {
+		workers_started = true;
+		for (int i = 0; i < AIO_WORKERS; i++)
+			thread_create ("aio_workerd", PRI_DEFAULT, aio_workerd, NULL);
+	}
+	lock_release (&queue_lock);
+
+	curr->aio = ctx;
+	return 0;
+}
+
+/* Takes up to TO_SUBMIT new SQEs from the current process's ring and
+ * hands them to the workers, then waits until at least MIN_COMPLETE
+ * completions are ready or nothing is left in flight. A request that
+ * fails at once completes with -1 right away. Submission stops early
+ * when the CQ could overflow. Returns the number of SQEs taken, or -1
+ * if there is no ring. */
+int
+aio_enter (unsigned to_submit, unsigned min_complete) {
+	struct aio_ctx *ctx = thread_current ()->aio;
+	unsigned submitted = 0;
+
+	if (ctx == NULL)
+		return -1;
+
+	lock_acquire (&ctx->lock);
+	aio_install_opened (ctx);
+	while (submitted < to_submit && aio_has_room (ctx)) {
+		uint32_t pending = ctx->ring->sq_tail - ctx->sq_head;
+		struct aio_sqe sqe;
+		struct aio_req *req;
+
+		if (pending == 0 || pending > AIO_RING_ENTRIES)
+			break;
+		sqe = ctx->ring->sq[ctx->sq_head % AIO_RING_ENTRIES];
+		ctx->ring->sq_head = ++ctx->sq_head;
+		ctx->inflight++;
+		submitted++;
+
+		/* Pinning may have to page the buffer in. */
+		lock_release (&ctx->lock);
+		req = aio_prepare (ctx, &sqe);
+		if (req != NULL) {
+			lock_acquire (&queue_lock);
+			list_push_back (&queue, &req->elem);
+			cond_signal (&queue_ready, &queue_lock);
+			lock_release (&queue_lock);
+		}
+		lock_acquire (&ctx->lock);
+
+		if (req == NULL) {
+			aio_post (ctx, sqe.user_data, -1);
+			ctx->inflight--;
+		}
+	}
+
+	if (min_complete > AIO_RING_ENTRIES)
+		min_complete = AIO_RING_ENTRIES;
+	while (aio_unreaped (ctx) < min_complete && ctx->inflight > 0) {
+		cond_wait (&ctx->done, &ctx->lock);
+		aio_install_opened (ctx);
+	}
+	lock_release (&ctx->lock);
+	return submitted;
+}
+
+/* Waits for the current process's requests to finish and frees its
+ * rings. Called on exit, before the fds and the memory the requests
+ * use go away. */
+void
+aio_exit (void) {
+	struct thread *curr = thread_current ();
+	struct aio_ctx *ctx = curr->aio;
+
+	if (ctx == NULL)
+		return;
+
+	lock_acquire (&ctx->lock);
+	while (ctx->inflight > 0)
+		cond_wait (&ctx->done, &ctx->lock);
+	lock_release (&ctx->lock);
+	while (!list_empty (&ctx->opened))
+		aio_req_free (list_entry (list_pop_front (&ctx->opened),
+				struct aio_req, elem));
+
+	vm_unpin_frame (ctx->ring_frame);
+	free (ctx);
+	curr->aio = NULL;
+}
+#else
+/* Without virtual memory there is no way to reach a process's memory
+ * from another thread, so there are no rings. */
+void
+aio_init (void) {
+}
+
+int
+aio_setup (struct aio_ring *ring UNUSED) {
+	return -1;
+}
+
+int
+aio_enter (unsigned to_submit UNUSED, unsigned min_complete UNUSED) {
+	return -1;
+}
+
+void
+aio_exit (void) {
+}
+#endif /* VM */
@@ -7,10 +7,12 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
+#include "userprog/aio.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h" // Jack
+#include "filesys/journal.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -27,6 +29,12 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_vfork (void *);
+static void __do_spawn (void *);
+static tid_t wait_child_start (tid_t child);
+static bool duplicate_fds (struct thread *child, struct thread *parent);
+static bool process_load (char *file_name, struct intr_frame *_if);
+static void vfork_release (void);
 
 /* General process initializer for initd and other process. */
 static void
@@ -92,14 +100,62 @@ process_fork (const char *name, struct intr_frame *if_ UNUSED) {
     /*** hyeRexx ***/
     /* replace 4th argument : thread_current() to if_ */
 	tid_t child = thread_create (name, PRI_DEFAULT, __do_fork, if_);
-    if(child == TID_ERROR) return TID_ERROR;
-    struct thread *child_t = get_child_process(child);
+    return wait_child_start(child);
+}
+
+/* Jack */
+/* Creates a child that runs in the current process's address space
+ * until it calls exec or exits, so nothing is copied but the fds.
+ * The caller stays blocked for that whole time. Returns the new
+ * process's thread id, or TID_ERROR on failure. */
+tid_t
+process_vfork (const char *name, struct intr_frame *if_) {
+	tid_t child = thread_create (name, PRI_DEFAULT, __do_vfork, if_);
+	return wait_child_start (child);
+}
+
+/* Jack */
+/* Starts a child process directly from CMD_LINE, which must be a
+ * malloc'd copy owned by the new process, without ever duplicating
+ * the caller's address space. Returns once the executable is loaded,
+ * with the new thread id or TID_ERROR if it could not be loaded. */
+tid_t
+process_spawn (const char *name, char *cmd_line) {
+	tid_t child = thread_create (name, PRI_DEFAULT, __do_spawn, cmd_line);
+	if (child == TID_ERROR)
+		free (cmd_line);
+	return wait_child_start (child);
+}
+
+/* Jack */
+/* Blocks until CHILD has signalled fork_sema and reports whether it
+ * started successfully. */
+static tid_t
+wait_child_start (tid_t child) {
+	if (child == TID_ERROR)
+		return TID_ERROR;
+	struct thread *child_t = get_child_process (child);
+
+	sema_down (&child_t->fork_sema);
+
+	/*** error check ***/
+	if (child_t->fork_flag == TID_ERROR)
+		return TID_ERROR;
+	return child;
+}
 
-    sema_down(&child_t->fork_sema);
-    
-    /*** error check ***/    
-    if(child_t->fork_flag == TID_ERROR) return TID_ERROR;
-    return child;
+/*** hyeRexx ***/
+/* Duplicates every open file of PARENT into CHILD's fdt. */
+static bool
+duplicate_fds (struct thread *child, struct thread *parent) {
+    for(int fd = child->fd_edge; fd < parent->fd_edge; fd = ++(child->fd_edge))
+    {
+        if(parent->fdt[fd] == NULL) continue;
+        child->fdt[fd] = file_duplicate(parent->fdt[fd]);
+        if(child->fdt[fd] == NULL) return false;
+    }
+    ASSERT(child->fd_edge == parent->fd_edge);
+    return true;
 }
 
 #ifndef VM
@@ -170,6 +226,8 @@ __do_fork (void *aux) {
 	supplemental_page_table_init (&curr_thread->spt);
 	if (!supplemental_page_table_copy (&curr_thread->spt, &parent->spt))
 		goto error;
+	if (!anon_map_copy (curr_thread, parent))
+		goto error;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
@@ -182,15 +240,10 @@ __do_fork (void *aux) {
 
 
     /*** hyeRexx : duplicate files ***/
-    for(int fd = curr_thread->fd_edge; fd < parent->fd_edge; fd = ++(curr_thread->fd_edge)) 
-    {
-        if(parent->fdt[fd] == NULL) continue; 
-        curr_thread->fdt[fd] = file_duplicate(parent->fdt[fd]);
-        if(curr_thread->fdt[fd] == NULL) goto error;
-    }
+    if (!duplicate_fds(curr_thread, parent))
+        goto error;
 
     /*** debugging genie : fork_flag 순서!! ***/
-    ASSERT(curr_thread->fd_edge == parent->fd_edge);
     curr_thread->fork_flag = 0;
     sema_up(&curr_thread->fork_sema);
 
@@ -206,11 +259,141 @@ error:
 	thread_exit ();
 }
 
+#ifdef VM
+/* Jack */
+/* Moves every anonymous mapping record of SRC to DST. */
+static void
+anon_maps_move (struct thread *dst, struct thread *src) {
+	while (!list_empty (&src->anon_maps))
+		list_push_back (&dst->anon_maps, list_pop_front (&src->anon_maps));
+	dst->anon_map_hint = src->anon_map_hint;
+	src->anon_map_hint = NULL;
+}
+#endif
+
+/* Jack */
+/* A thread function that borrows the parent's address space instead of
+ * copying it. The parent stays blocked on fork_sema until
+ * vfork_release() hands the address space back on exec or exit. */
+static void
+__do_vfork (void *aux) {
+	struct intr_frame if_;
+	struct thread *curr_thread = thread_current ();
+	struct thread *parent = curr_thread->parent;
+	struct intr_frame *parent_if = aux;
+
+	memcpy (&if_, parent_if, sizeof (struct intr_frame));
+
+	/* Borrow the page table and, with VM, the spt. The parent is
+	 * blocked, so moving them by value is safe. */
+	curr_thread->pml4 = parent->pml4;
+#ifdef VM
+	curr_thread->spt = parent->spt;
+	anon_maps_move (curr_thread, parent);
+	curr_thread->running_file = file_duplicate(parent->running_file);
+#endif
+	curr_thread->vfork_parent = parent;
+	process_activate (curr_thread);
+
+#ifdef FILESYS
+	curr_thread->working_dir = dir_reopen(parent->working_dir);
+#endif
+
+	if (!duplicate_fds (curr_thread, parent))
+		goto error;
+
+	/* fork_sema is signalled by vfork_release(), not here. */
+	curr_thread->fork_flag = 0;
+	process_init ();
+	if_.R.rax = 0; // return to child's vfork
+
+	do_iret (&if_);
+
+error:
+	curr_thread->fork_flag = -1;
+	curr_thread->exit_status = -1;
+	thread_exit ();
+}
+
+/* Jack */
+/* Returns the borrowed address space to the vfork parent and wakes it
+ * up. Must run before the current process tears down its own. */
+static void
+vfork_release (void) {
+	struct thread *curr = thread_current ();
+	struct thread *parent = curr->vfork_parent;
+
+	if (parent == NULL)
+		return;
+
+#ifdef VM
+	parent->spt = curr->spt;
+	supplemental_page_table_init (&curr->spt);
+	anon_maps_move (parent, curr);
+#endif
+	curr->pml4 = NULL;
+	pml4_activate (NULL);
+	curr->vfork_parent = NULL;
+	sema_up (&curr->fork_sema);
+}
+
+/* Jack */
+/* A thread function that loads a new executable straight into a fresh
+ * address space. Only the fds and the working directory come from the
+ * parent, so the cost does not depend on the parent's size. */
+static void
+__do_spawn (void *aux) {
+	struct intr_frame if_;
+	struct thread *curr_thread = thread_current ();
+	struct thread *parent = curr_thread->parent;
+	char *cmd_line = aux;
+
+	process_init ();
+#ifdef FILESYS
+	curr_thread->working_dir = dir_reopen(parent->working_dir);
+#endif
+	if (!duplicate_fds (curr_thread, parent)) {
+		free (cmd_line);
+		goto error;
+	}
+
+	/* PROCESS_LOAD frees CMD_LINE itself if it fails. */
+	if (!process_load (cmd_line, &if_))
+		goto error;
+
+	curr_thread->fork_flag = 0;
+	sema_up (&curr_thread->fork_sema);
+	do_iret (&if_);
+
+error:
+	curr_thread->fork_flag = -1;
+	curr_thread->exit_status = -1;
+	sema_up (&curr_thread->fork_sema);
+	thread_exit ();
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int
 process_exec (void *f_name) {
-	char *file_name = f_name;
+	/* We cannot use the intr_frame in the thread structure.
+	 * This is because when current thread rescheduled,
+	 * it stores the execution information to the member. */
+	struct intr_frame _if;
+
+	if (!process_load (f_name, &_if))
+		return -1;
+
+	/* Start switched process. */
+	do_iret (&_if);
+	NOT_REACHED ();
+}
+
+/* Replaces the current address space with the executable and
+ * arguments in FILE_NAME, filling _IF for entering it.
+ * FILE_NAME is freed on failure. Returns true on success. */
+static bool
+process_load (char *file_name, struct intr_frame *_if) {
 	char **args_parsed = calloc(64, sizeof(char *));
 	// char **args_parsed = palloc_get_page(0);
 	char *save_ptr;
@@ -218,18 +401,14 @@ process_exec (void *f_name) {
 	int arg_count;
 	bool success;
 
-	/* We cannot use the intr_frame in the thread structure.
-	 * This is because when current thread rescheduled,
-	 * it stores the execution information to the member. */
-	struct intr_frame _if;
-	_if.ds = _if.es = _if.ss = SEL_UDSEG;
-	_if.cs = SEL_UCSEG;
-	_if.eflags = FLAG_IF | FLAG_MBS;
+	_if->ds = _if->es = _if->ss = SEL_UDSEG;
+	_if->cs = SEL_UCSEG;
+	_if->eflags = FLAG_IF | FLAG_MBS;
 
 	/*** Jack ***/
 	/* Parsing file_name */ 
 	arg_count = 0;
-	for (arg = strtok_r(f_name, " ", &save_ptr); arg != NULL; arg = strtok_r(NULL, " ", &save_ptr))
+	for (arg = strtok_r(file_name, " ", &save_ptr); arg != NULL; arg = strtok_r(NULL, " ", &save_ptr))
 		args_parsed[arg_count++] = arg;
 
 	/* We first kill the current context */
@@ -240,7 +419,7 @@ process_exec (void *f_name) {
 #endif
 
 	/* And then load the binary */
-	success = load (args_parsed[0], &_if);
+	success = load (args_parsed[0], _if);
 
 	/* If load failed, quit. */
 	if (!success)
@@ -249,17 +428,14 @@ process_exec (void *f_name) {
 		free(args_parsed);
 	    // palloc_free_page(file_name);
 	    // palloc_free_page(args_parsed);
-		return -1;
+		return false;
     }
 
 	/*** Jack ***/
 	/* Set arguments to interrupt frame */
-	argument_stack(args_parsed, arg_count, &_if);
-	// hex_dump(_if.rsp, _if.rsp, USER_STACK - _if.rsp, true);
-
-	/* Start switched process. */
-	do_iret (&_if);
-	NOT_REACHED ();
+	argument_stack(args_parsed, arg_count, _if);
+	// hex_dump(_if->rsp, _if->rsp, USER_STACK - _if->rsp, true);
+	return true;
 }
 
 /*** GrilledSalmon ***/
@@ -344,6 +520,12 @@ process_exit (void) {
     if(curr->pml4 != NULL)
 	    printf("%s: exit(%d)\n", curr->name, curr->exit_status); 
 
+	/* Jack - requests in flight use the fds and the memory below */
+	aio_exit ();
+	/* Jack - a process killed in a file system call leaves its
+	 * operation open */
+	journal_abandon ();
+
 	/*** Jack ***/
 	/*** Cleanup resources related to file system ***/
 	int curr_fd_edge;
@@ -375,8 +557,12 @@ static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
+	/* Jack - a vfork child must give the address space back first */
+	vfork_release ();
+
 #ifdef VM
 	supplemental_page_table_kill (&curr->spt);
+	anon_map_kill (curr);
 #endif
 
 	uint64_t *pml4;
@@ -834,6 +1020,14 @@ setup_stack (struct intr_frame *if_) {
 	/* prj3 - Anonymous Page, yeopto */
 	vm_alloc_page(VM_ANON | VM_STACK, stack_bottom, 1);
 	success = vm_claim_page(stack_bottom);
+
+	/* Jack - prefault the rest of the initial stack, best effort */
+	for (size_t i = 1; success && i < stack_prefault_pages; i++) {
+		void *va = stack_bottom - i * PGSIZE;
+		if ((uint8_t *) va < STACK_LIMIT
+				|| !vm_alloc_page(VM_ANON | VM_STACK, va, 1) || !vm_claim_page(va))
+			break;
+	}
 	/* prj3 - Anonymous Page, yeopto */
 	if (success) {
 		if_->rsp = USER_STACK; 
@@ -27,6 +27,8 @@
 #include "vm/vm.h"
 #include "filesys/directory.h"
 #include "filesys/inode.h"
+#include "userprog/aio.h"
+#include "filesys/journal.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -44,6 +46,13 @@ int read (int fd, void *buffer, unsigned size); 	/*** GrilledSalmon ***/
 int write (int fd, void *buffer, unsigned size);    /*** GrilledSalmon ***/
 unsigned tell (int fd);                             /*** GrilledSalmon ***/
 
+/* Jack */
+int pread (int fd, void *buffer, unsigned size, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, int out_fd, unsigned size);
+
 typedef int pid_t;
 int wait (pid_t pid);                               /*** Jack ***/
 int exec (const char *cmd_line);                    /*** Jack ***/
@@ -51,7 +60,9 @@ int exec (const char *cmd_line);                    /*** Jack ***/
 /*** hyeRexx : phase 3 ***/
 pid_t fork(const char *thread_name, struct intr_frame *intr_f);
 
-static struct lock filesys_lock;                    /*** GrilledSalmon ***/
+/* Jack */
+pid_t spawn (const char *file, const char **argv);
+pid_t vfork (struct intr_frame *intr_f);
 
 /* eleshock */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
@@ -85,8 +96,6 @@ bool chdir (const char *dir);
 void
 syscall_init (void)
 {
-    lock_init(&filesys_lock);       /*** GrilledSalmon ***/
-
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -96,6 +105,8 @@ syscall_init (void)
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	aio_init(); // Jack
 }
 
 /*** hyeRexx ***/
@@ -200,6 +211,42 @@ syscall_handler (struct intr_frame *f UNUSED)
         case SYS_SYMLINK : // Jack
             f->R.rax = symlink(f->R.rdi, f->R.rsi);
             break;
+
+        case SYS_SPAWN : // Jack
+            f->R.rax = spawn(f->R.rdi, f->R.rsi);
+            break;
+
+        case SYS_VFORK : // Jack
+            f->R.rax = vfork(f);
+            break;
+
+        case SYS_PREAD : // Jack
+            f->R.rax = pread(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+            break;
+
+        case SYS_PWRITE : // Jack
+            f->R.rax = pwrite(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+            break;
+
+        case SYS_READV : // Jack
+            f->R.rax = readv(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+
+        case SYS_WRITEV : // Jack
+            f->R.rax = writev(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+
+        case SYS_COPY_FILE_RANGE : // Jack
+            f->R.rax = copy_file_range(f->R.rdi, f->R.rsi, f->R.rdx);
+            break;
+
+        case SYS_AIO_SETUP : // Jack
+            f->R.rax = aio_setup(f->R.rdi);
+            break;
+
+        case SYS_AIO_ENTER : // Jack
+            f->R.rax = aio_enter(f->R.rdi, f->R.rsi);
+            break;
     }
 }
 
@@ -294,13 +341,31 @@ void exit (int status)
 /*** hyeRexx ***/
 /*** debugging genie : do we need to check sysout, sysin? ***/
 int open(const char *file)
+{
+    /* Jack - opening is split out for the asynchronous I/O workers */
+    struct file *now_file = open_file(file);
+    if (now_file == NULL)
+        return -1;
+
+    int fd = process_add_file(now_file);
+    if (fd == -1)
+        file_close(now_file);
+
+    return fd; // return file descriptor for 'file'
+}
+
+/* Jack */
+/* Opens FILE, following symbolic links, relative to the current
+ * thread's working directory. A directory comes back with its dir
+ * attached. Returns NULL on failure. */
+struct file *open_file(const char *file)
 {
     /* prj4 filesys - yeopto */
     char file_name[15];
 
     struct dir *found_dir;
     if ((found_dir = find_dir_from_path(file, file_name)) == NULL)
-        return -1;
+        return NULL;
     // printf("\nnow dir : %p\n", dir_get_inode(thread_current()->working_dir));
     struct file *now_file = NULL;
     if (strlen(file_name) != 0) {
@@ -316,36 +381,32 @@ int open(const char *file)
         now_file = file_open(dir_get_inode(found_dir));
     }
 
-    if (!now_file || inode_get_removed(file_get_inode(now_file))) {
-        return -1;
+    if (!now_file)
+        return NULL;
+    if (inode_get_removed(file_get_inode(now_file))) {
+        file_close(now_file);
+        return NULL;
     }
 
     enum file_type t = inode_get_type(file_get_inode(now_file));
     if (t == F_ORD) {
-        int fd = process_add_file(now_file);
-        if (fd == -1)
-            file_close(now_file);
-        
-        return fd; // return file descriptor for 'file'
+        return now_file;
     } else if (t == F_DIR) {
         struct dir *now_dir = dir_open(file_get_inode(now_file));
         file_set_dir(now_file, now_dir, true);
-
-        int fd = process_add_file(now_file);
-        if (fd == -1)
-            file_close(now_file);
-        
-        return fd;
+        return now_file;
     } else if (t == F_LINK) {
         off_t length = file_length(now_file);
         char *real_path = calloc(1, length + 1);
         file_read(now_file, real_path, length);
         file_close(now_file);
 
-        int ret = open(real_path);
+        struct file *ret = open_file(real_path);
         free(real_path);
         return ret;
     }
+    file_close(now_file);
+    return NULL;
 }
 
 /*** hyeRexx ***/
@@ -386,14 +447,12 @@ int read (int fd, void *buffer, unsigned size)
         /*** extra할 때 수정된대유 ***/
 
         char *buffer_cursor = buffer;
-        lock_acquire(&filesys_lock);    // debugging genie
         while (read_len < size)
         {
             *buffer_cursor++ = input_getc();
             read_len++;
         }
         *buffer_cursor = '\0';
-        lock_release(&filesys_lock);
         return read_len;
 	}
 
@@ -403,9 +462,8 @@ int read (int fd, void *buffer, unsigned size)
         return -1;
     }
 
-    lock_acquire(&filesys_lock);
+    /* Jack - the file system locks what it needs itself */
     read_len = file_read(now_file, buffer, size);
-    lock_release(&filesys_lock);
     return read_len;
 }
 
@@ -415,9 +473,7 @@ int write (int fd, void *buffer, unsigned size)
     check_address(buffer);
 
     if (fd == 1) {                      // fd == stdout인 경우
-        lock_acquire(&filesys_lock);
         putbuf(buffer, size);
-        lock_release(&filesys_lock);
         return size;
     }
 
@@ -430,9 +486,7 @@ int write (int fd, void *buffer, unsigned size)
     if (inode_get_type(file_get_inode(now_file)) != F_ORD)
         return -1;
 
-    lock_acquire(&filesys_lock);
     uint64_t read_len = file_write(now_file, buffer, size);
-    lock_release(&filesys_lock);
 
     return read_len;
 }
@@ -447,6 +501,218 @@ unsigned tell (int fd)
     return file_tell(now_file);
 }
 
+/* Jack */
+/* Returns the regular file open as FD, or NULL if there is none. */
+struct file *
+get_ordinary_file (int fd)
+{
+    struct file *now_file = process_get_file(fd);
+
+    if (now_file == NULL || fd == 0 || fd == 1)
+        return NULL;
+    if (inode_get_type(file_get_inode(now_file)) != F_ORD)
+        return NULL;
+    return now_file;
+}
+
+/* Jack */
+/* Reads SIZE bytes at OFFSET of FD into BUFFER, leaving the file
+ * position alone. */
+int pread (int fd, void *buffer, unsigned size, off_t offset)
+{
+    check_address(buffer);
+
+    struct page *p = spt_find_page(&thread_current()->spt, buffer);
+    if (p != NULL && !p->writable)
+        exit(-1);
+
+    struct file *now_file = get_ordinary_file(fd);
+    if (now_file == NULL || offset < 0)
+        return -1;
+    return file_read_at(now_file, buffer, size, offset);
+}
+
+/* Jack */
+/* Writes SIZE bytes from BUFFER at OFFSET of FD, leaving the file
+ * position alone. */
+int pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+    check_address(buffer);
+
+    struct file *now_file = get_ordinary_file(fd);
+    if (now_file == NULL || offset < 0)
+        return -1;
+    return file_write_at(now_file, buffer, size, offset);
+}
+
+/* Jack */
+/* Checks the IOVCNT buffers of IOV before any data moves, killing the
+ * process on a bad address. Returns false if the request is invalid. */
+static bool
+check_iov (const struct iovec *iov, int iovcnt, bool write)
+{
+    size_t total = 0;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX)
+        return false;
+    if (iovcnt == 0)
+        return true;
+    check_address(iov);
+    check_address(&iov[iovcnt] - 1);
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0)
+            continue;
+        check_address(iov[i].iov_base);
+        check_address(iov[i].iov_base + iov[i].iov_len - 1);
+        if (!write) {
+            struct page *p = spt_find_page(&thread_current()->spt,
+                    iov[i].iov_base);
+            if (p != NULL && !p->writable)
+                exit(-1);
+        }
+        total += iov[i].iov_len;
+        if (iov[i].iov_len > INT32_MAX || total > INT32_MAX)
+            return false;
+    }
+    return true;
+}
+
+/* Jack */
+/* Moves data between FILE, from its position on, and the IOVCNT
+ * buffers of IOV, advancing the position. Runs of buffers smaller than
+ * a page are gathered in a bounce page, so the file sees one request
+ * per page of data instead of one per buffer. Returns the number of
+ * bytes moved. */
+static int
+file_iov (struct file *file, const struct iovec *iov, int iovcnt,
+        bool write)
+{
+    uint8_t *bounce = palloc_get_page(0);
+    int total = 0;
+
+    for (int i = 0, j; i < iovcnt; i = j) {
+        size_t want = iov[i].iov_len;
+        off_t moved;
+
+        j = i + 1;
+        if (bounce == NULL || want >= PGSIZE) {
+            moved = write? file_write(file, iov[i].iov_base, want):
+                file_read(file, iov[i].iov_base, want);
+        } else {
+            /* Gather the run of buffers that fits in a page. */
+            while (j < iovcnt && want + iov[j].iov_len <= PGSIZE)
+                want += iov[j++].iov_len;
+
+            size_t ofs = 0;
+            if (write) {
+                for (int k = i; k < j; k++) {
+                    memcpy(bounce + ofs, iov[k].iov_base, iov[k].iov_len);
+                    ofs += iov[k].iov_len;
+                }
+                moved = file_write(file, bounce, want);
+            } else {
+                moved = file_read(file, bounce, want);
+                size_t got = moved;
+                for (int k = i; k < j && ofs < got; k++) {
+                    size_t chunk = iov[k].iov_len < got - ofs?
+                        iov[k].iov_len: got - ofs;
+                    memcpy(iov[k].iov_base, bounce + ofs, chunk);
+                    ofs += chunk;
+                }
+            }
+        }
+
+        total += moved;
+        if ((size_t) moved < want)
+            break;
+    }
+
+    if (bounce != NULL)
+        palloc_free_page(bounce);
+    return total;
+}
+
+/* Jack */
+/* Reads from FD into the IOVCNT buffers of IOV in order. */
+int readv (int fd, const struct iovec *iov, int iovcnt)
+{
+    if (!check_iov(iov, iovcnt, false))
+        return -1;
+
+    if (fd == 0) {
+        /* Unlike read(), no terminator goes past the buffers. */
+        int total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            char *cursor = iov[i].iov_base;
+            for (size_t k = 0; k < iov[i].iov_len; k++)
+                *cursor++ = input_getc();
+            total += iov[i].iov_len;
+        }
+        return total;
+    }
+
+    struct file *now_file = get_ordinary_file(fd);
+    if (now_file == NULL)
+        return -1;
+    return file_iov(now_file, iov, iovcnt, false);
+}
+
+/* Jack */
+/* Writes the IOVCNT buffers of IOV to FD in order. */
+int writev (int fd, const struct iovec *iov, int iovcnt)
+{
+    if (!check_iov(iov, iovcnt, true))
+        return -1;
+
+    if (fd == 1) {
+        int total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            putbuf(iov[i].iov_base, iov[i].iov_len);
+            total += iov[i].iov_len;
+        }
+        return total;
+    }
+
+    struct file *now_file = get_ordinary_file(fd);
+    if (now_file == NULL)
+        return -1;
+    return file_iov(now_file, iov, iovcnt, true);
+}
+
+/* Jack */
+/* Copies up to SIZE bytes from IN_FD to OUT_FD inside the kernel,
+ * from and to their file positions, which advance. OUT_FD may be
+ * stdout. Returns the number of bytes copied. */
+int copy_file_range (int in_fd, int out_fd, unsigned size)
+{
+    struct file *in = get_ordinary_file(in_fd);
+    if (in == NULL || size > INT32_MAX)
+        return -1;
+
+    if (out_fd != 1) {
+        struct file *out = get_ordinary_file(out_fd);
+        if (out == NULL)
+            return -1;
+        return file_copy(out, in, size);
+    }
+
+    uint8_t *bounce = palloc_get_page(0);
+    int copied = 0;
+    if (bounce == NULL)
+        return -1;
+    while (size > 0) {
+        off_t chunk = size < PGSIZE? size: PGSIZE;
+        off_t got = file_read(in, bounce, chunk);
+        putbuf((char *) bounce, got);
+        copied += got;
+        size -= got;
+        if (got < chunk)
+            break;
+    }
+    palloc_free_page(bounce);
+    return copied;
+}
+
 /*** Jack ***/
 int wait (pid_t pid)
 {
@@ -473,10 +739,58 @@ pid_t fork (const char *thread_name, struct intr_frame *intr_f) // 파라미터
     return (child == TID_ERROR) ? TID_ERROR : child; 
 }
 
+/* Jack */
+/* Start FILE as a new process with arguments ARGV[1..], ARGV[0] being
+ * taken from FILE as exec() does. ARGV may be NULL. Arguments are
+ * passed through the same space-separated command line as exec(). */
+pid_t spawn (const char *file, const char **argv)
+{
+    check_address(file);
+
+    size_t len = strlen(file) + 1;
+    int argc = 1;
+    if (argv != NULL)
+    {
+        check_address(argv);
+        if (argv[0] == NULL)
+            argv = NULL;
+    }
+    while (argv != NULL)
+    {
+        check_address(&argv[argc]);
+        if (argv[argc] == NULL)
+            break;
+        check_address(argv[argc]);
+        len += strlen(argv[argc++]) + 1;
+    }
+
+    char *cmd_line = malloc(len + 1);
+    if (cmd_line == NULL)
+        return TID_ERROR;
+    strlcpy(cmd_line, file, len + 1);
+    for (int i = 1; i < argc; i++)
+    {
+        strlcat(cmd_line, " ", len + 1);
+        strlcat(cmd_line, argv[i], len + 1);
+    }
+
+    return process_spawn(file, cmd_line);
+}
+
+/* Jack */
+pid_t vfork (struct intr_frame *intr_f)
+{
+    return process_vfork(thread_name(), intr_f);
+}
+
 
 /* eleshock */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset)
 {
+    /* Jack - anonymous mapping, NULL addr means kernel's choice */
+    if (fd == MAP_ANON)
+        return offset == 0 && is_user_vaddr(addr)? do_mmap_anon(addr, length, writable): NULL;
+
     struct file *now_file = process_get_file(fd);
     bool chk_addr = (addr != NULL) && is_user_vaddr(addr); // debug
     return now_file && chk_addr? do_mmap(addr, length, writable, now_file, offset): NULL;
@@ -486,7 +800,8 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset)
 void munmap (void *addr)
 {
     check_address(addr);
-    do_munmap(addr);
+    if (!do_munmap_anon(addr))
+        do_munmap(addr);
 }
 
 /* eleshock */
@@ -555,6 +870,7 @@ bool mkdir (const char *dir_)
     char dir_name[15];
     struct dir *dir;
     
+    journal_begin(); // Jack - the new directory appears whole or not at all
     if ((success = ((dir = find_dir_from_path(dir_, dir_name)) != NULL)) == false)
         goto done;
 
@@ -591,6 +907,7 @@ bool mkdir (const char *dir_)
 
     // printf("\nmkdir : %s\n", dir_);
 done:
+    journal_end();
     return success;
 }
 
@@ -605,6 +922,7 @@ int symlink (const char *target, const char *linkpath)
     struct dir *link_dir;
     char link_name[15];
 
+    journal_begin(); // Jack
     if ((link_dir = find_dir_from_path(linkpath, link_name)) == NULL)
         goto done;
 
@@ -631,5 +949,6 @@ int symlink (const char *target, const char *linkpath)
     dir_close(link_dir);
 
 done:
+    journal_end();
     return success;
 }
@@ -2,6 +2,8 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include <round.h>
+#include <string.h>
 
 /* DO NOT MODIFY BELOW LINE */
 // static struct disk *swap_disk; // 수정하지 말랬지만, 그냥 파일 분리했음 - Jack
@@ -42,26 +44,40 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 }
 
 /* Jack */
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk.
+ * The slot is kept as a clean copy while swap space allows, so a
+ * page that is not written before its next eviction costs no I/O. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
-	bool ret = swapdisk_swap_in(anon_page->swap_slot, kva, false);
-	if (ret == true)
+	bool retain = swapdisk_can_retain();
+	bool ret = swapdisk_swap_in(anon_page->swap_slot, kva, retain);
+	if (ret == true && !retain)
 		anon_page->swap_slot = -1;
 	return ret;
 }
 
 /* Jack */
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.
+ * A page that still matches its swap copy is simply dropped. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-	if ((anon_page->swap_slot = swapdisk_swap_out(page->frame->kva)) == -1)
+	if (anon_swap_copy_valid(page))
+		return true;
+	if ((anon_page->swap_slot = swapdisk_swap_out(page->frame->kva, anon_page->swap_slot)) == -1)
 		return false;
 	return true;
 }
 
+/* Jack */
+/* True if PAGE is resident and its swap slot holds the same contents. */
+bool
+anon_swap_copy_valid (struct page *page) {
+	return page->frame != NULL && page->anon.swap_slot != -1
+		&& !pml4_is_dirty(page->pml4, page->va);
+}
+
 /* eleshock */
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
@@ -69,14 +85,153 @@ anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
 
 	/* eleshock */
-	struct frame *fr = page->frame;
 	/* Jack */
-	if (fr != NULL)
-	{
-		ft_delete(fr);
-		// palloc_free_page(fr->kva); // pml4 destroy에서 알아서 해줌
-		free(fr);
-	} else {
+	vm_release_frame(page);
+	if (anon_page->swap_slot != -1)
 		swapdisk_free_swap_slot(anon_page->swap_slot);
+}
+
+/* Jack */
+/* Find PAGE_CNT unused pages for a hint-less anonymous mapping.
+ * Scans down from the lowest address handed out so far, then retries
+ * from the top once so holes left by munmap get reused.
+ * Returns NULL if no such range exists. */
+static void *
+anon_map_find_free (size_t page_cnt) {
+	struct thread *curr = thread_current ();
+	uint8_t *top = curr->anon_map_hint != NULL? curr->anon_map_hint: ANON_MAP_TOP;
+
+	for (int pass = 0; pass < 2; pass++) {
+		size_t run = 0;
+		for (uint8_t *va = top - PGSIZE; va >= ANON_MAP_BOTTOM; va -= PGSIZE) {
+			if (spt_find_page (&curr->spt, va) != NULL)
+				run = 0;
+			else if (++run == page_cnt)
+				return va;
+		}
+		top = ANON_MAP_TOP;
+	}
+	return NULL;
+}
+
+/* Jack */
+/* Remove PAGE_CNT pages from ADDR out of the current process,
+ * releasing their frames and swap slots. */
+static void
+anon_map_remove_pages (void *addr, size_t page_cnt) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		void *va = addr + i * PGSIZE;
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL)
+			continue;
+
+		spt_remove_page (spt, page);
+	}
+}
+
+/* Jack */
+/* Map LENGTH bytes of zero-filled anonymous memory at ADDR, or at an
+ * address of the kernel's choice if ADDR is NULL. Pages are populated
+ * lazily on first touch. Returns the mapped address, NULL on failure. */
+void *
+do_mmap_anon (void *addr, size_t length, bool writable) {
+	struct thread *curr = thread_current ();
+	bool hintless = addr == NULL;
+
+	if ((int) length <= 0 || pg_ofs (addr) != 0)
+		return NULL;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+	if (hintless) {
+		if ((addr = anon_map_find_free (page_cnt)) == NULL)
+			return NULL;
+	} else {
+		if (!is_user_vaddr (addr + page_cnt * PGSIZE - 1) || addr + page_cnt * PGSIZE < addr
+				|| overlaps_stack (addr, page_cnt * PGSIZE))
+			return NULL;
+		for (size_t i = 0; i < page_cnt; i++)
+			if (spt_find_page (&curr->spt, addr + i * PGSIZE) != NULL)
+				return NULL;
+	}
+
+	struct anon_map *map = malloc (sizeof *map);
+	if (map == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < page_cnt; i++) {
+		if (!vm_alloc_page (VM_ANON | VM_ANONMAP, addr + i * PGSIZE, writable)) {
+			anon_map_remove_pages (addr, i);
+			free (map);
+			return NULL;
+		}
+	}
+
+	map->addr = addr;
+	map->page_cnt = page_cnt;
+	list_push_back (&curr->anon_maps, &map->elem);
+	if (hintless)
+		curr->anon_map_hint = addr;
+	return addr;
+}
+
+/* Jack */
+/* Unmap the anonymous mapping that starts at ADDR. Its memory goes
+ * straight back to the user pool and the swap disk.
+ * Returns false if ADDR is not the start of an anonymous mapping. */
+bool
+do_munmap_anon (void *addr) {
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+
+	for (e = list_begin (&curr->anon_maps); e != list_end (&curr->anon_maps); e = list_next (e)) {
+		struct anon_map *map = list_entry (e, struct anon_map, elem);
+		if (map->addr != addr)
+			continue;
+
+		anon_map_remove_pages (map->addr, map->page_cnt);
+
+		/* Let the next hint-less search start above the hole. */
+		uint8_t *end = (uint8_t *) map->addr + map->page_cnt * PGSIZE;
+		if (curr->anon_map_hint != NULL && end > (uint8_t *) curr->anon_map_hint && end <= ANON_MAP_TOP)
+			curr->anon_map_hint = end;
+
+		list_remove (&map->elem);
+		free (map);
+		return true;
+	}
+	return false;
+}
+
+/* Jack */
+/* Copy the anonymous mapping records of SRC to DST on fork.
+ * The pages themselves are copied along with the spt. */
+bool
+anon_map_copy (struct thread *dst, struct thread *src) {
+	struct list_elem *e;
+
+	for (e = list_begin (&src->anon_maps); e != list_end (&src->anon_maps); e = list_next (e)) {
+		struct anon_map *map = list_entry (e, struct anon_map, elem);
+		struct anon_map *copy = malloc (sizeof *copy);
+		if (copy == NULL)
+			return false;
+		copy->addr = map->addr;
+		copy->page_cnt = map->page_cnt;
+		list_push_back (&dst->anon_maps, &copy->elem);
+	}
+	dst->anon_map_hint = src->anon_map_hint;
+	return true;
+}
+
+/* Jack */
+/* Forget every anonymous mapping record of T. Called after the spt,
+ * which owns the pages, has been destroyed. */
+void
+anon_map_kill (struct thread *t) {
+	while (!list_empty (&t->anon_maps)) {
+		struct anon_map *map = list_entry (list_pop_front (&t->anon_maps), struct anon_map, elem);
+		free (map);
 	}
+	t->anon_map_hint = NULL;
 }
@@ -28,9 +28,11 @@ vm_file_init (void) {
 }
 
 /* Initialize the file backed page */
+/* Jack - KVA is unused and may be NULL: with the page cache the data
+ * is never copied into a frame of our own. */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
-	if (page == NULL || kva == NULL)
+file_backed_initializer (struct page *page, enum vm_type type, void *kva UNUSED) {
+	if (page == NULL)
 		return false;
 	
 	ASSERT(VM_TYPE(type) == VM_FILE);
@@ -126,7 +128,7 @@ file_backed_swap_out (struct page *page) {
 		lock_release(&file_lock);
 	}
 	
-	pml4_set_dirty(page->pml4, page, 0);
+	pml4_set_dirty(page->pml4, page->va, 0);
 	return true;
 }
 
@@ -137,6 +139,12 @@ file_backed_destroy (struct page *page) {
 	ASSERT(page != NULL);
 
 	struct file_page *file_page = &page->file;
+
+#ifdef EFILESYS
+	/* Jack - the frame belongs to the page cache, which keeps any
+	 * dirty data and writes it back later */
+	page_cache_unmap (page);
+#else
 	struct file *file = file_page->m_file;
 	off_t ofs = file_page->ofs;
 	uint32_t write_bytes = file_page->read_bytes;
@@ -154,9 +162,9 @@ file_backed_destroy (struct page *page) {
 			// ASSERT(file_write_at(file, kva, write_bytes, ofs) == (int) write_bytes); // debug
 			pml4_set_dirty(page->pml4, page->va, false);
 		}
-		ft_delete(page->frame);
-		free(page->frame);
+		vm_release_frame(page); // Jack
 	}
+#endif
 
 	if ((--(*(file_page->open_count))) == 0) // debugging sanori - 한줄로 넣느라 연산자 남발해서 제대로 안되면 확인 필요함
 	{	
@@ -169,6 +177,30 @@ file_backed_destroy (struct page *page) {
 	}
 }
 
+#ifdef EFILESYS
+/* Jack */
+/* Claims file page PAGE by mapping the page cache frame that holds its
+ * data, so read(), write() and every mapping of the same file page
+ * share one frame. The lazy loader (or copy_page() on fork) is not
+ * run; there is nothing to copy. */
+bool
+file_backed_claim (struct page *page) {
+	if (page->operations->type == VM_UNINIT)
+	{
+		enum vm_type type = page->uninit.type;
+		void *aux = page->uninit.aux;
+
+		if (!file_backed_initializer(page, type, NULL))
+			return false;
+		/* A VM_FCOPY aux is the parent's page, the others were
+		 * allocated for us. */
+		if (VM_SUBTYPE(type) != VM_FCOPY)
+			free(aux);
+	}
+	return page_cache_map(page);
+}
+#endif
+
 /* prj 3 memery mapped files - yeopto */
 static bool
 lazy_load_file (struct page *page, void *aux) {
@@ -197,6 +229,7 @@ void *
 do_mmap (void *_addr, size_t length, int writable,
 		struct file *_file, off_t _offset) {
 	if ((int)length <= 0 || pg_ofs(_addr) != 0 || pg_ofs(_offset) != 0 || file_length(_file) <= _offset) return NULL; // debug
+	if (overlaps_stack(_addr, length)) return NULL; // Jack - keep the stack and its guard free
 	size_t read_bytes = length;
 	size_t zero_bytes = pg_ofs(read_bytes) == 0? 0: PGSIZE - pg_ofs(read_bytes); // debug
 	ASSERT((read_bytes + zero_bytes) % PGSIZE == 0);
@@ -255,28 +288,14 @@ do_munmap (void *addr) {
 	{
 		// printf("\ntotal page %d, \n", total_count);
 		// printf("\ncurrent page %d, \n", curr_count);
-		// spt remove시 page가 지워지므로 unmap 및 free 위해 임시 저장함
-		uint64_t *curr_pml4 = curr_page->pml4;
-		void *curr_uva = curr_page->va;
-		void *curr_kva = curr_page->frame != NULL? curr_page->frame->kva: NULL; // debug
-
 		// debug
 		// printf("\ncurrent va %p, \n", curr_uva);
 		// printf("\nexist before removing? %d\n", spt_find_page(spt, curr_uva)!=NULL? 1:0);
 
 		// spt에서 해당 page를 제거하면서 type별 destroy를 실행하고, page를 free함
+		// Jack - destroy가 pml4 매핑 해제 및 kva free까지 해줌
 		spt_remove_page(spt, curr_page);
 
-		// debug
-		// printf("\nremove page complete? %d\n", spt_find_page(spt, curr_uva)==NULL? 1:0);
-
-		// pml4에서 매핑 해제해주고 kva를 free해줌
-		if (curr_kva != NULL)
-		{
-			pml4_clear_page(curr_pml4, curr_uva);
-			palloc_free_page(curr_kva);
-		}
-
 		curr_page = spt_find_page(spt, addr + PGSIZE * curr_count); // debugging sanori - 후위연산으로 증가시켜줬는데, 문제 없는지 확인필요함
 		
 		// debug
@@ -7,6 +7,7 @@ static struct disk *swap_disk;
 static struct bitmap *swap_table;
 static struct lock swap_table_lock;
 static struct lock *st_lock = &swap_table_lock;
+static swap_slot_t used_slot_cnt;
 
 /* Initialize swapdisk and swaptable */
 void swapdisk_init(void)
@@ -32,6 +33,7 @@ swap_slot_t swapdisk_get_swap_slot(void)
     lock_acquire(st_lock);
     if ((slot = bitmap_scan_and_flip(swap_table, 0, 1, false)) == BITMAP_ERROR)
         PANIC("NO MORE SWAPSLOT AVAILABLE");
+    used_slot_cnt++;
     lock_release(st_lock);
     return slot;
 }
@@ -42,9 +44,20 @@ void swapdisk_free_swap_slot(swap_slot_t slot)
     ASSERT (bitmap_test(swap_table, slot) == true);
     lock_acquire(st_lock);
     bitmap_set(swap_table, slot, false);
+    used_slot_cnt--;
     lock_release(st_lock);
 }
 
+/*
+Return true if a swapped-in page may keep its slot as a clean copy.
+Copies are only kept while at least half of the swap disk is free,
+so they never push other pages out of swap.
+*/
+bool swapdisk_can_retain(void)
+{
+    return used_slot_cnt < (swap_slot_t) bitmap_size(swap_table) / 2;
+}
+
 /*
 By using SLOT, calculate sector no. and
 read pagesize data from that sector of disk to physical memory _KVA.
@@ -68,17 +81,18 @@ bool swapdisk_swap_in(swap_slot_t slot, void *_kva, bool copy)
 }
 
 /*
-Find available swap slot from swapdisk and
-write pagesize data from physical memory _KVA to disk.
+Write pagesize data from physical memory _KVA to SLOT of swapdisk,
+or to a newly allocated slot if SLOT is -1.
 Return swap slot written.
 */
-swap_slot_t swapdisk_swap_out(void *_kva)
+swap_slot_t swapdisk_swap_out(void *_kva, swap_slot_t slot)
 {
     if (_kva == NULL)
         return -1;
 
     void *kva = _kva;
-    swap_slot_t slot = swapdisk_get_swap_slot();
+    if (slot == -1)
+        slot = swapdisk_get_swap_slot();
     disk_sector_t sector = SECTOR(slot);
     ASSERT (sector < disk_size(swap_disk));
 
@@ -6,6 +6,7 @@
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "lib/string.h"
+#include <stdio.h>
 
 
 
@@ -13,6 +14,28 @@
 /* Global Frame table */
 static struct frame_table ft;
 
+/* Jack */
+/* Stack growth tuning, set by the -sc and -sp kernel options. */
+size_t stack_chunk_pages = 4;
+size_t stack_prefault_pages = 1;
+
+/* Jack */
+/* Victim selection policy, set by the -ev kernel option. */
+enum evict_policy evict_policy = EVICT_COST;
+
+/* Jack */
+/* Clock hand over ft.table, protected by ft.lock. */
+static struct list_elem *clock_hand;
+
+/* Jack */
+/* Statistics. */
+static long long fault_cnt;         /* # of faults handled by the VM. */
+static long long stack_fault_cnt;   /* # of those that grew the stack. */
+static long long stack_page_cnt;    /* # of stack pages added by growth. */
+static long long evict_cnt;         /* # of evicted frames. */
+static long long evict_clean_cnt;   /* # of those evicted without any write. */
+static long long swap_write_saved;  /* # of swap sector writes avoided. */
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -29,6 +52,16 @@ vm_init (void) {
 	ft_init();
 }
 
+/* Jack */
+/* Prints VM statistics. */
+void
+vm_print_stats (void) {
+	printf ("VM: %lld faults, %lld stack faults, %lld stack pages grown\n",
+			fault_cnt, stack_fault_cnt, stack_page_cnt);
+	printf ("VM: %lld evictions, %lld clean, %lld swap sector writes saved\n",
+			evict_cnt, evict_clean_cnt, swap_write_saved);
+}
+
 /* Get the type of the page. This function is useful if you want to know the
  * type of the page after it will be initialized.
  * This function is fully implemented now. */
@@ -139,50 +172,268 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	struct hash_elem *e = &page->hash_elem;
 
 	hash_delete(h, e);
+	vm_wait_page_io (page);
 	vm_dealloc_page (page);
 
 	return true;
 }
 
+/* Jack */
+/* Returns the frame under the clock hand and advances the hand.
+ * ft.lock must be held and ft.table must not be empty. */
+static struct frame *
+clock_advance (void) {
+	if (clock_hand == NULL || clock_hand == list_end (&ft.table))
+		clock_hand = list_begin (&ft.table);
+	struct frame *frame = list_entry (clock_hand, struct frame, f_elem);
+	clock_hand = list_next (clock_hand);
+	return frame;
+}
+
+/* Jack */
+/* Relative cost of evicting FRAME: 0 if it can just be dropped, 1 if
+ * it must be written back to its file, 2 if it must go to swap. */
+static int
+eviction_cost (struct frame *frame) {
+	struct page *page = frame->page;
+
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_FILE:
+			return pml4_is_dirty (page->pml4, page->va)? 1: 0;
+		case VM_ANON:
+			return anon_swap_copy_valid (page)? 0: 2;
+#ifdef EFILESYS
+		case VM_PAGE_CACHE:
+			return page_cache_is_dirty (page)? 1: 0;
+#endif
+		default:
+			return 2;
+	}
+}
+
+/* Jack */
+/* Returns whether FRAME was referenced since the last call and
+ * clears the reference. A page cache frame counts as referenced if
+ * it was read or written or any of its mappings was touched.
+ * ft.lock must be held. */
+static bool
+frame_test_accessed (struct frame *frame) {
+	struct page *page = frame->page;
+
+#ifdef EFILESYS
+	if (VM_TYPE (page->operations->type) == VM_PAGE_CACHE)
+		return page_cache_test_accessed (page);
+#endif
+	if (!pml4_is_accessed (page->pml4, page->va))
+		return false;
+	pml4_set_accessed (page->pml4, page->va, false);
+	return true;
+}
+
+/* Jack */
+/* Removes every mapping of FRAME's page, so it cannot change while
+ * it is written out. ft.lock must be held. */
+static void
+frame_unmap (struct frame *frame) {
+	struct page *page = frame->page;
+
+#ifdef EFILESYS
+	if (VM_TYPE (page->operations->type) == VM_PAGE_CACHE) {
+		page_cache_unmap_all (page);
+		return;
+	}
+#endif
+	pml4_clear_page (page->pml4, page->va);
+}
+
 /* Get the struct frame, that will be evicted. */
+/* Jack - With EVICT_COST, recently used frames still get a second
+ * chance, but among the others a free-to-drop frame is taken at once.
+ * Failing that, the cheapest one seen in a full sweep is taken.
+ * ft.lock must be held. Returns NULL if every frame is busy. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
-	struct list *f_list = &ft.table;
-	struct list_elem *curr_f_elem;
-	lock_acquire(&ft.lock);
-	for (curr_f_elem = list_begin(f_list); ; curr_f_elem = list_next(curr_f_elem) == list_tail(f_list)? list_begin(f_list): list_next(curr_f_elem))
+	int victim_cost = 0;
+	size_t frame_cnt = list_size(&ft.table);
+	for (size_t i = 0; i < 3 * frame_cnt; i++)
 	{
-		struct frame *curr_frame = list_entry(curr_f_elem, struct frame, f_elem);
-		if (pml4_is_accessed(curr_frame->page->pml4, curr_frame->page->va))
+		struct frame *curr_frame = clock_advance();
+
+		/* Frames under I/O or pinned are not evictable. */
+		if (curr_frame->state != FRAME_INUSE || curr_frame->pin_cnt > 0)
+			continue;
+
+		if (frame_test_accessed(curr_frame))
+			continue;
+		if (evict_policy == EVICT_CLOCK)
 		{
-			pml4_set_accessed(curr_frame->page->pml4, curr_frame->page->va, false);
+			victim = curr_frame;
+			break;
 		}
-		else
+
+		int cost = eviction_cost(curr_frame);
+		if (victim == NULL || cost < victim_cost)
 		{
 			victim = curr_frame;
-			break;
+			victim_cost = cost;
 		}
+		if (victim_cost == 0 || i >= frame_cnt)
+			break;
 	}
-	lock_release(&ft.lock);
 	return victim;
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
+/* Jack - ft.lock is only held to pick the victim and to publish its
+ * state, never across the write-back itself. The page is unmapped
+ * first, so it cannot change while it is written; a thread faulting
+ * on it meanwhile waits in vm_wait_page_io(). */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim = vm_get_victim ();
+	struct frame *victim;
 	/* TODO: swap out the victim and return the evicted frame. */
-	if (swap_out(victim->page))
-	{	
-		pml4_clear_page(victim->page->pml4,victim->page->va);
-		victim->page->frame = NULL;
+	lock_acquire(&ft.lock);
+	while ((victim = vm_get_victim()) == NULL)
+		cond_wait(&ft.io_done, &ft.lock);
+	struct page *page = victim->page;
+	victim->state = FRAME_WRITEBACK;
+	frame_unmap(victim);
+	lock_release(&ft.lock);
+
+	bool clean = eviction_cost(victim) == 0;
+	bool anon = VM_TYPE(page->operations->type) == VM_ANON;
+	bool success = swap_out(page);
+
+	lock_acquire(&ft.lock);
+	if (success)
+	{
+		evict_cnt++;
+		if (clean)
+		{
+			evict_clean_cnt++;
+			if (anon)
+				swap_write_saved += SECTOR_PER_SLOT;
+		}
+		page->frame = NULL;
 		victim->page = NULL;
-		return victim;
+		victim->state = FRAME_FREE;
+	}
+	else
+	{
+		if (page->pml4 != NULL)
+			pml4_set_page(page->pml4, page->va, victim->kva, page->writable);
+		victim->state = FRAME_INUSE;
+		victim = NULL;
 	}
-	return NULL;
+	cond_broadcast(&ft.io_done, &ft.lock);
+	lock_release(&ft.lock);
+	return victim;
+}
+
+/* Jack */
+/* Waits until PAGE is not under I/O. Afterwards the page is either
+ * resident in a FRAME_INUSE frame or has no frame at all. */
+void
+vm_wait_page_io (struct page *page) {
+	lock_acquire(&ft.lock);
+	while (page->frame != NULL && page->frame->state != FRAME_INUSE)
+		cond_wait(&ft.io_done, &ft.lock);
+	lock_release(&ft.lock);
+}
+
+/* Jack */
+/* Keeps PAGE's frame from being evicted while its contents are used
+ * directly, e.g. copied on fork. Pins nest, so several threads may
+ * use the same frame at once. Returns the pinned frame, or NULL if
+ * PAGE is not resident. Release it with vm_unpin_frame(). */
+struct frame *
+vm_pin_page (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire(&ft.lock);
+	while (page->frame != NULL && page->frame->state != FRAME_INUSE)
+		cond_wait(&ft.io_done, &ft.lock);
+	frame = page->frame;
+	if (frame != NULL)
+		frame->pin_cnt++;
+	lock_release(&ft.lock);
+	return frame;
+}
+
+/* Jack */
+/* Pins the frame of the current process's page at VA, bringing the
+ * page in first if it is not resident, so that a kernel thread can
+ * reach the memory without the process's page table. Returns the
+ * pinned frame, or NULL if nothing is mapped at VA. */
+struct frame *
+vm_pin_user_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
+	struct frame *frame;
+
+	if (page == NULL)
+		return NULL;
+	while ((frame = vm_pin_page (page)) == NULL)
+		if (!vm_do_claim_page (page))
+			return NULL;
+	return frame;
+}
+
+/* Jack */
+/* Drops a pin taken by vm_pin_page() or vm_load_page(). */
+void
+vm_unpin_frame (struct frame *frame) {
+	lock_acquire(&ft.lock);
+	ASSERT (frame->pin_cnt > 0);
+	frame->pin_cnt--;
+	cond_broadcast(&ft.io_done, &ft.lock);
+	lock_release(&ft.lock);
+}
+
+/* Jack */
+/* Frame table lock, for code that keeps extra mappings of a frame
+ * (the page cache) in step with eviction. */
+void
+ft_acquire (void) {
+	lock_acquire(&ft.lock);
+}
+
+void
+ft_release (void) {
+	lock_release(&ft.lock);
+}
+
+/* Jack */
+/* Unmaps PAGE and frees its frame, if any. Called by the destroy
+ * operations. Waits for I/O on the page first, and takes the frame
+ * out of the table before an evictor can pick it. */
+void
+vm_release_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire(&ft.lock);
+	while (page->frame != NULL && page->frame->state != FRAME_INUSE)
+		cond_wait(&ft.io_done, &ft.lock);
+	frame = page->frame;
+	if (frame == NULL)
+	{
+		lock_release(&ft.lock);
+		return;
+	}
+	/* A pin can be left behind by a copy to user memory that faulted
+	 * and killed the process; the frame goes away regardless. */
+	if (clock_hand == &frame->f_elem)
+		clock_hand = list_next(clock_hand);
+	list_remove(&frame->f_elem);
+	page->frame = NULL;
+	lock_release(&ft.lock);
+
+	if (page->pml4 != NULL)
+		pml4_clear_page(page->pml4, page->va);
+	palloc_free_page(frame->kva);
+	free(frame);
 }
 
 /* Jack */
@@ -191,6 +442,7 @@ void ft_init(void)
 {
 	list_init(&ft.table);
 	lock_init(&ft.lock);
+	cond_init(&ft.io_done);
 }
 
 /* Insert FR to global frame table */
@@ -208,6 +460,8 @@ struct frame *ft_delete(struct frame *fr)
 	ASSERT(fr != NULL);
 
 	lock_acquire(&ft.lock);
+	if (clock_hand == &fr->f_elem)
+		clock_hand = list_next(clock_hand);
 	struct list_elem *next = list_remove(&fr->f_elem);
 	lock_release(&ft.lock);
 
@@ -225,15 +479,18 @@ vm_get_frame (void) {
 	/* eleshock */
 	void *pp = palloc_get_page(PAL_USER);
 	if (pp == NULL) {
-		frame = vm_evict_frame();
-		ASSERT (frame != NULL);
+		while ((frame = vm_evict_frame()) == NULL)
+			continue;
 		ASSERT (frame->page == NULL);
+		ASSERT (frame->state == FRAME_FREE);
 		goto ret;
 	}
 	
 	frame = malloc(sizeof(struct frame));
 	frame->kva = pp;
 	frame->page = NULL;
+	frame->state = FRAME_FREE;
+	frame->pin_cnt = 0;
   
 
 	ASSERT (frame != NULL);
@@ -247,11 +504,28 @@ ret:
 }
 
 /* Growing the stack. */
+/* Jack - grows by stack_chunk_pages at once: the faulting page is left to
+ * the caller to claim and the pages below it are claimed right away, so
+ * a stack that keeps going down faults once per chunk. */
 static void
 vm_stack_growth (void *addr UNUSED) {
 	/* prj3 Stack Growth, yeopto */
-	if (addr >= (void *)(USER_STACK - (1 << 20))) {
-		vm_alloc_page(VM_ANON | VM_STACK, addr, 1);
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *top = pg_round_down (addr);
+	uint8_t *va;
+
+	if (top < STACK_LIMIT)
+		return;
+
+	stack_fault_cnt++;
+	for (va = top; va >= STACK_LIMIT && va > top - stack_chunk_pages * PGSIZE; va -= PGSIZE) {
+		if (spt_find_page (spt, va) != NULL)
+			break;
+		if (!vm_alloc_page (VM_ANON | VM_STACK, va, 1))
+			break;
+		stack_page_cnt++;
+		if (va != top)
+			vm_claim_page (va);
 	}
 }
 
@@ -272,13 +546,20 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	/* Jack */
 	// read only page에 접근한 경우는 real fault
 	if (!not_present) return false; // debugging sanori - 어차피 kernel addr 들어왔거나 NULL 들어오면 spt_find_page에서 걸러지지 않을까?
+	fault_cnt++;
 
 	void* rsp = (void *)(user? f->rsp: thread_current()->if_rsp);
-	if (rsp - addr == 0x8 || ((void *)USER_STACK > addr) && (addr > rsp))
+	if ((rsp - addr == 0x8 || ((void *)USER_STACK > addr) && (addr > rsp))
+			&& spt_find_page(spt, addr) == NULL)
 		vm_stack_growth(addr);
 
 	// 유효한 접근인지 spt_find를 통해 확인하고 유호하다면 처리, 아니면 return false
-	return ((page = spt_find_page(spt, addr)) == NULL)? false : vm_do_claim_page (page);
+	if ((page = spt_find_page(spt, addr)) == NULL)
+		return false;
+
+	/* Jack - a page under write-back is read back after the write ends */
+	vm_wait_page_io(page);
+	return page->frame != NULL? true: vm_do_claim_page (page);
 }
 
 /* Free the page.
@@ -303,27 +584,85 @@ vm_claim_page (void *va UNUSED) { // debugging sanori - va가 유효한지 확
 	return page != NULL? vm_do_claim_page (page): false;
 }
 
-/* Claim the PAGE and set up the mmu. */
-static bool
-vm_do_claim_page (struct page *page) {
-	if (page == NULL) return false;
+/* Jack */
+/* Gives PAGE a frame and brings its contents in, without mapping it
+ * anywhere. Returns the frame pinned, or NULL on failure. */
+/* Jack */
+/* Gives FRAME back after vm_load_page() could not fill it or it could
+ * not be mapped for PAGE. Unlinks the two, drops the pin the caller
+ * holds if PINNED, and wakes anyone waiting for I/O on PAGE, who will
+ * then find it not present. */
+static void
+vm_discard_frame (struct page *page, struct frame *frame, bool pinned) {
+	lock_acquire(&ft.lock);
+	page->frame = NULL;
+	frame->page = NULL;
+	frame->state = FRAME_FREE;
+	if (pinned)
+		frame->pin_cnt--;
+	if (clock_hand == &frame->f_elem)
+		clock_hand = list_next(clock_hand);
+	list_remove(&frame->f_elem);
+	cond_broadcast(&ft.io_done, &ft.lock);
+	lock_release(&ft.lock);
+
+	palloc_free_page(frame->kva);
+	free(frame);
+}
 
+struct frame *
+vm_load_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
-	uint64_t *pml4 = thread_current()->pml4;
 
 	/* prj3 - Anonymous Page, yeopto */
-	if (page->operations->type == VM_UNINIT && VM_SUBTYPE(page->uninit.type) == VM_STACK)
+	if (page->operations->type == VM_UNINIT && (VM_SUBTYPE(page->uninit.type) & (VM_STACK | VM_ANONMAP)))
 		memset(frame->kva, 0, PGSIZE);
 
 	/* Set links */
+	/* Jack - the frame stays FRAME_READIN until the contents are in */
+	lock_acquire(&ft.lock);
+	frame->state = FRAME_READIN;
 	frame->page = page;
 	page->frame = frame;
+	lock_release(&ft.lock);
+
+	if (!swap_in (page, frame->kva)) {
+		vm_discard_frame (page, frame, false);
+		return NULL;
+	}
+
+	lock_acquire(&ft.lock);
+	frame->state = FRAME_INUSE;
+	frame->pin_cnt++;
+	cond_broadcast(&ft.io_done, &ft.lock);
+	lock_release(&ft.lock);
+	return frame;
+}
+
+/* Claim the PAGE and set up the mmu. */
+static bool
+vm_do_claim_page (struct page *page) {
+	if (page == NULL) return false;
+
+#ifdef EFILESYS
+	/* Jack - file pages share the page cache's frame */
+	if (page_get_type (page) == VM_FILE)
+		return file_backed_claim (page);
+#endif
+
+	struct frame *frame = vm_load_page (page);
+	uint64_t *pml4 = thread_current()->pml4;
+	if (frame == NULL)
+		return false;
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	if (!pml4_set_page(pml4, page->va, frame->kva, page->writable)) // Jack // debugging sanori - 쓰기를 1로 두어야할지? 이 함수가 언제 쓰일때 다시 고민해볼 수 있을듯 - page에 write 관련 필드가 필요할까?
+	if (!pml4_set_page(pml4, page->va, frame->kva, page->writable)) { // Jack // debugging sanori - 쓰기를 1로 두어야할지? 이 함수가 언제 쓰일때 다시 고민해볼 수 있을듯 - page에 write 관련 필드가 필요할까?
+		vm_discard_frame (page, frame, true);
 		return false;
+	}
 
-	return swap_in (page, frame->kva);
+	vm_unpin_frame (frame);
+	return true;
 }
 
 /* prj3-memory management, yeopto */
@@ -359,12 +698,15 @@ bool
 copy_page (struct page *page, void *aux)
 {
 	struct page *parent_page = aux;
+	struct frame *parent_frame = vm_pin_page(parent_page);
 	
-	if (parent_page->frame != NULL)
+	if (parent_frame != NULL)
 	{
-		void *parent_kva = parent_page->frame->kva;
+		void *parent_kva = parent_frame->kva;
 		void *child_kva = page->frame->kva;
-		return memcpy(child_kva, parent_kva, PGSIZE)!=NULL? true: false;
+		memcpy(child_kva, parent_kva, PGSIZE);
+		vm_unpin_frame(parent_frame);
+		return true;
 	} else {
 		switch (page_get_type(parent_page))
 		{
@@ -378,6 +720,7 @@ copy_page (struct page *page, void *aux)
 			break;
 		}
 	}
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -412,6 +755,12 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 				}
 				// debugging sanori - NULL인 경우도 있나?
 			}
+			else if (VM_TYPE(src_p->uninit.type) == VM_ANON)
+			{
+				// Jack - 아직 접근하지 않은 anonymous mmap 영역
+				if (!vm_alloc_page(src_p->uninit.type, src_p->va, src_p->writable))
+					return false;
+			}
 			break;
 		case VM_ANON:
 			aux = src_p;
@@ -434,6 +783,7 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 void
 spt_destructor (struct hash_elem *e, void *aux UNUSED) {
 	struct page *page = hash_entry(e, struct page, hash_elem);
+	vm_wait_page_io(page);
 	vm_dealloc_page(page);
 }
 